@@ -0,0 +1,321 @@
+#include "Batch.hpp"
+#include "Jobs.hpp"
+#include "Sched.hpp"
+#include "Telemetry.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+bool infer_from_filename(const std::string &in_path, int &w, int &h,
+                         int &fps) {
+  try {
+    std::filesystem::path p(in_path);
+    std::string name = p.stem().string();
+    // Match ..._<W>x<H>[_<FPS>]_...
+    std::regex re(
+        R"((?:^|[^0-9])([0-9]+)\s*x\s*([0-9]+)(?:[^0-9]+([0-9]{1,3}))?)",
+        std::regex::icase);
+    std::smatch m;
+    if (std::regex_search(name, m, re)) {
+      int iw = std::stoi(m[1].str());
+      int ih = std::stoi(m[2].str());
+      int ifps = fps; // keep incoming default unless group 3 exists
+      if (m.size() >= 4 && m[3].matched) {
+        try {
+          ifps = std::stoi(m[3].str());
+        } catch (...) {
+        }
+      }
+      if (iw > 0 && ih > 0) {
+        w = iw;
+        h = ih;
+        fps = ifps;
+        return true;
+      }
+    }
+  } catch (...) {
+  }
+  return false;
+}
+
+namespace {
+
+std::string lower_ext(const fs::path &p) {
+  std::string ext = p.extension().string();
+  for (auto &c : ext)
+    c = (char)std::tolower((unsigned char)c);
+  return ext;
+}
+
+bool is_clip(const fs::path &p) {
+  const std::string ext = lower_ext(p);
+  return ext == ".yuv" || ext == ".y4m";
+}
+
+bool is_list_file(const std::string &spec) {
+  if (!spec.empty() && spec[0] == '@')
+    return true;
+  const std::string ext = lower_ext(spec);
+  return ext == ".txt" || ext == ".lst";
+}
+
+bool has_wildcard(const std::string &s) {
+  return s.find_first_of("*?") != std::string::npos;
+}
+
+// 简单通配：* 匹配任意串，? 匹配单个字符
+bool wild_match(const char *pat, const char *s) {
+  const char *star = nullptr, *back = nullptr;
+  while (*s) {
+    if (*pat == '?' || *pat == *s) {
+      ++pat;
+      ++s;
+    } else if (*pat == '*') {
+      star = pat++;
+      back = s;
+    } else if (star) {
+      pat = star + 1;
+      s = ++back;
+    } else {
+      return false;
+    }
+  }
+  while (*pat == '*')
+    ++pat;
+  return *pat == 0;
+}
+
+std::string trim(const std::string &s) {
+  size_t a = s.find_first_not_of(" \t\r\n");
+  if (a == std::string::npos)
+    return std::string();
+  size_t b = s.find_last_not_of(" \t\r\n");
+  return s.substr(a, b - a + 1);
+}
+
+// 单个片段：规划结果 + 剩余任务计数（归零时写 manifest）
+struct Clip {
+  fs::path input;
+  std::string name; // out_dir 下的子目录名
+  std::string skip; // 非空：未运行的原因
+  DefectRun run;
+  std::atomic<size_t> remaining{0};
+  bool ok = false;
+  size_t failed = 0;
+};
+
+} // namespace
+
+bool is_batch_spec(const std::string &spec) {
+  std::error_code ec;
+  if (fs::is_directory(spec, ec))
+    return true;
+  if (has_wildcard(fs::path(spec).filename().string()))
+    return true;
+  return is_list_file(spec);
+}
+
+std::vector<fs::path> collect_inputs(const std::string &spec) {
+  std::vector<fs::path> v;
+  std::error_code ec;
+  if (fs::is_directory(spec, ec)) {
+    for (fs::recursive_directory_iterator
+             it(spec, fs::directory_options::skip_permission_denied, ec),
+         end;
+         !ec && it != end; it.increment(ec)) {
+      if (it->is_regular_file(ec) && is_clip(it->path()))
+        v.push_back(it->path());
+    }
+  } else if (has_wildcard(fs::path(spec).filename().string())) {
+    // 仅文件名部分支持通配；目录部分按字面解析
+    fs::path p(spec);
+    fs::path dir = p.has_parent_path() ? p.parent_path() : fs::path(".");
+    const std::string pat = p.filename().string();
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end;
+         it.increment(ec)) {
+      if (it->is_regular_file(ec) &&
+          wild_match(pat.c_str(), it->path().filename().string().c_str()))
+        v.push_back(it->path());
+    }
+  } else {
+    // 列表文件：相对路径按列表所在目录解析
+    fs::path list(spec[0] == '@' ? spec.substr(1) : spec);
+    std::ifstream ifs(list);
+    std::string line;
+    while (std::getline(ifs, line)) {
+      line = trim(line);
+      if (line.empty() || line[0] == '#')
+        continue;
+      fs::path p(line);
+      if (p.is_relative() && list.has_parent_path())
+        p = list.parent_path() / p;
+      v.push_back(p.lexically_normal());
+    }
+    return v; // 保持列表顺序
+  }
+  std::sort(v.begin(), v.end());
+  return v;
+}
+
+int run_batch(const Settings &base, const std::vector<DefectEntry> &sel,
+              bool wh_from_cli, bool fps_from_cli) {
+  const std::vector<fs::path> inputs = collect_inputs(base.in_path);
+  if (inputs.empty()) {
+    std::cerr << "no inputs matched: " << base.in_path << "\n";
+    return 1;
+  }
+  Settings bs = base;
+  if (bs.seed == 0) {
+    bs.seed = (uint64_t)std::chrono::high_resolution_clock::now()
+                  .time_since_epoch()
+                  .count();
+  }
+  if (bs.out_dir.empty()) {
+    std::time_t t = std::time(nullptr);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "out_%Y%m%d_%H%M%S", std::localtime(&t));
+    bs.out_dir = buf;
+  }
+  if (!ensure_dir(bs.out_dir)) {
+    std::cerr << "cannot create out dir\n";
+    return 2;
+  }
+  const int workers = bs.jobs > 0 ? bs.jobs : hw_threads();
+
+  // 子目录名取文件名（无扩展名），重名时追加序号
+  std::vector<std::unique_ptr<Clip>> clips;
+  std::map<std::string, int> used;
+  for (auto &in : inputs) {
+    auto c = std::make_unique<Clip>();
+    c->input = in;
+    c->name = in.stem().string();
+    int n = used[c->name]++;
+    if (n > 0)
+      c->name += "_" + std::to_string(n + 1);
+    clips.push_back(std::move(c));
+  }
+
+  // 1) 规划：逐片段推断尺寸/帧率并抽取参数。每个片段的种子由 (seed, 子目录名)
+  //    派生，与输入顺序和并行度无关
+  run_jobs(clips.size(), workers, [&](size_t i) {
+    Clip &c = *clips[i];
+    Settings s = bs;
+    s.in_path = c.input.string();
+    s.out_dir = bs.out_dir / c.name;
+    s.seed = derive_seed(bs.seed, c.name);
+    if (!wh_from_cli || !fps_from_cli) {
+      int iw = s.w, ih = s.h, ifps = s.fps;
+      if (infer_from_filename(s.in_path, iw, ih, ifps)) {
+        if (!wh_from_cli) {
+          s.w = iw;
+          s.h = ih;
+        }
+        if (!fps_from_cli)
+          s.fps = ifps;
+      }
+    }
+    if (lower_ext(c.input) != ".y4m" && (s.w <= 0 || s.h <= 0)) {
+      c.skip = "no WxH in filename";
+      return;
+    }
+    Context ctx;
+    ctx.cfg = s;
+    if (!init_context(ctx)) {
+      c.skip = "init failed";
+      return;
+    }
+    // 并行度来自片段之间，fan-out 时每个片段只解码一次
+    plan_run(c.run, ctx, sel, 1);
+    c.remaining = c.run.tasks.size();
+  });
+
+  // 2) 执行：所有片段的任务进入同一个队列，某个慢片段不会阻塞其它片段
+  std::vector<std::pair<size_t, size_t>> queue;
+  for (size_t i = 0; i < clips.size(); ++i)
+    for (size_t t = 0; t < clips[i]->run.tasks.size(); ++t)
+      queue.emplace_back(i, t);
+
+  std::mutex mu;
+  size_t done = 0, runnable = 0;
+  for (auto &c : clips)
+    if (c->skip.empty())
+      ++runnable;
+    else
+      std::cerr << "[batch] skip " << c->input.generic_string() << ": "
+                << c->skip << "\n";
+  auto finish = [&](Clip &c) {
+    std::vector<OutFile> outs;
+    c.ok = collect_run(c.run, outs);
+    for (auto &o : outs)
+      if (o.details == "FAILED")
+        ++c.failed;
+    if (!write_manifest(c.run.ctx, outs))
+      std::cerr << "failed to write manifest for " << c.name << "\n";
+    std::lock_guard<std::mutex> lk(mu);
+    ++done;
+    std::cerr << "[batch " << done << "/" << runnable << "] " << c.name
+              << (c.ok ? " ok" : " FAILED") << "\n";
+  };
+  for (auto &c : clips)
+    if (c->skip.empty() && c->run.tasks.empty())
+      finish(*c);
+  for (auto &c : clips)
+    progress_add(c->run.tasks.size(),
+                 c->run.ctx.total_frames * pending_outputs(c->run));
+
+  // 按开销调度：大分辨率片段先启动并分到更多线程，小片段填满剩余核
+  std::vector<TaskCost> costs;
+  costs.reserve(queue.size());
+  for (auto &q : queue)
+    costs.push_back(task_cost(clips[q.first]->run, q.second));
+  run_scheduled(costs, sched_options(bs), [&](size_t q, const CpuSlot &slot) {
+    Clip &c = *clips[queue[q].first];
+    exec_task(c.run, queue[q].second, slot.threads);
+    if (c.remaining.fetch_sub(1) == 1)
+      finish(c);
+  });
+  // 各片段共用同一个缓存实例，整批结束后淘汰一次
+  for (auto &c : clips)
+    if (c->run.ctx.cache) {
+      c->run.ctx.cache->trim();
+      break;
+    }
+
+  // 3) 汇总
+  size_t n_ok = 0, n_fail = 0, n_skip = 0;
+  std::ostringstream body;
+  for (auto &c : clips) {
+    body << "  - " << c->name << " | " << c->input.generic_string() << " | ";
+    if (!c->skip.empty()) {
+      ++n_skip;
+      body << "SKIPPED (" << c->skip << ")\n";
+      continue;
+    }
+    (c->ok ? n_ok : n_fail)++;
+    body << "seed=" << c->run.ctx.cfg.seed << " size=" << c->run.ctx.cfg.w
+         << "x" << c->run.ctx.cfg.h << " outputs=" << c->run.plans.size()
+         << " failed=" << c->failed << "\n";
+  }
+  std::ostringstream ss;
+  ss << "batch=" << base.in_path << "\n";
+  ss << "seed=" << bs.seed << "\n";
+  ss << "clips=" << clips.size() << " ok=" << n_ok << " failed=" << n_fail
+     << " skipped=" << n_skip << "\n";
+  ss << "clips:\n" << body.str();
+  if (!write_text(bs.out_dir / "index.txt", ss.str()))
+    std::cerr << "failed to write index\n";
+
+  std::cout << "Done. " << n_ok << "/" << clips.size()
+            << " clips ok. Outputs in: " << bs.out_dir << "\n";
+  return (n_fail || n_skip) ? 3 : 0;
+}
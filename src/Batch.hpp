@@ -0,0 +1,21 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "Defects.hpp"
+
+// 批处理：一次运行处理多个输入片段。所有 (片段 × 缺陷) 任务进入同一个全局队列，
+// 每个片段写入 out_dir/<片段名>/manifest.txt，另有汇总 out_dir/index.txt
+
+// 从文件名推断 WxH 与帧率（如 foo_352x288_25_bar.yuv）
+bool infer_from_filename(const std::string& in_path, int& w, int& h, int& fps);
+
+// 输入是否为批量描述：目录、含 * ? 的通配符、@列表文件或 .txt/.lst 列表文件
+bool is_batch_spec(const std::string& spec);
+// 展开为排好序的输入列表（目录递归收集 .yuv/.y4m；列表文件每行一个路径，# 开头为注释）
+std::vector<std::filesystem::path> collect_inputs(const std::string& spec);
+
+// base：命令行设置（in_path 为批量描述）；wh_from_cli/fps_from_cli 为假时按文件名逐个推断
+// 返回进程退出码（0=全部成功）
+int run_batch(const Settings& base, const std::vector<DefectEntry>& sel,
+              bool wh_from_cli, bool fps_from_cli);
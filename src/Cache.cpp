@@ -0,0 +1,246 @@
+#include "Cache.hpp"
+#include "Fs.hpp"
+#include "Hash.hpp"
+#include "Process.hpp"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+#ifdef __linux__
+bool reflink(const fs::path &src, const fs::path &dst) {
+  int s = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+  if (s < 0)
+    return false;
+  int d = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (d < 0) {
+    ::close(s);
+    return false;
+  }
+  const bool ok = ioctl(d, FICLONE, s) == 0;
+  ::close(s);
+  ::close(d);
+  if (!ok) {
+    std::error_code ec;
+    fs::remove(dst, ec);
+  }
+  return ok;
+}
+#endif
+
+// 同目录下的临时名：进程内按线程区分，跨进程靠随后的原子重命名
+fs::path tmp_name(const fs::path &p) {
+  std::ostringstream ss;
+  ss << ".tmp" << std::hash<std::thread::id>{}(std::this_thread::get_id());
+  fs::path t = p;
+  return t.concat(ss.str());
+}
+
+bool write_meta(const fs::path &p, const CacheEntry &e) {
+  std::ostringstream ss;
+  ss << "kind=" << e.kind << "\n"
+     << "details=" << e.details << "\n"
+     << "frames=" << e.frames << "\n"
+     << "wall_s=" << e.wall_s << "\n"
+     << "cpu_s=" << e.cpu_s << "\n"
+     << "fps=" << e.fps << "\n"
+     << "speed=" << e.speed << "\n";
+  return write_text(p, ss.str());
+}
+
+bool read_meta(const fs::path &p, CacheEntry &e) {
+  std::ifstream ifs(p);
+  if (!ifs)
+    return false;
+  std::string line;
+  bool any = false;
+  while (std::getline(ifs, line)) {
+    const size_t eq = line.find('=');
+    if (eq == std::string::npos)
+      continue;
+    const std::string k = line.substr(0, eq), v = line.substr(eq + 1);
+    any = true;
+    if (k == "kind")
+      e.kind = v;
+    else if (k == "details")
+      e.details = v;
+    else if (k == "frames")
+      e.frames = std::strtoull(v.c_str(), nullptr, 10);
+    else if (k == "wall_s")
+      e.wall_s = std::strtod(v.c_str(), nullptr);
+    else if (k == "cpu_s")
+      e.cpu_s = std::strtod(v.c_str(), nullptr);
+    else if (k == "fps")
+      e.fps = std::strtod(v.c_str(), nullptr);
+    else if (k == "speed")
+      e.speed = std::strtod(v.c_str(), nullptr);
+  }
+  return any;
+}
+
+} // namespace
+
+bool link_or_copy(const fs::path &src, const fs::path &dst) {
+  std::error_code ec;
+  fs::remove(dst, ec);
+  fs::create_hard_link(src, dst, ec);
+  if (!ec)
+    return true;
+#ifdef __linux__
+  if (reflink(src, dst))
+    return true;
+#endif
+  ec.clear();
+  fs::copy_file(src, dst, fs::copy_options::overwrite_existing, ec);
+  return !ec;
+}
+
+std::string ffmpeg_version(const std::string &ffmpeg) {
+  static std::mutex mu;
+  static std::map<std::string, std::string> seen;
+  std::lock_guard<std::mutex> lk(mu);
+  auto it = seen.find(ffmpeg);
+  if (it != seen.end())
+    return it->second;
+  std::string v = exec_read_all({ffmpeg, "-version"});
+  v = v.substr(0, v.find_first_of("\r\n"));
+  seen[ffmpeg] = v;
+  return v;
+}
+
+bool ResultCache::open(const fs::path &dir, uint64_t max_bytes) {
+  dir_ = dir;
+  max_bytes_ = max_bytes;
+  return ensure_dir(dir_ / "objects") && ensure_dir(dir_ / "inputs");
+}
+
+fs::path ResultCache::object(const std::string &key, const char *ext) const {
+  return dir_ / "objects" / key.substr(0, 2) / (key + ext);
+}
+
+bool ResultCache::fetch(const std::string &key, const fs::path &dst,
+                        CacheEntry &e) {
+  const fs::path obj = object(key, ".mp4"), meta = object(key, ".meta");
+  std::error_code ec;
+  if (!fs::exists(obj, ec) || !read_meta(meta, e))
+    return false;
+  if (!link_or_copy(obj, dst))
+    return false;
+  // 记录最近使用时间（不动对象本身：它可能与输出文件共用 inode）
+  fs::last_write_time(meta, fs::file_time_type::clock::now(), ec);
+  return true;
+}
+
+bool ResultCache::store(const std::string &key, const fs::path &src,
+                        const CacheEntry &e) {
+  const fs::path obj = object(key, ".mp4"), meta = object(key, ".meta");
+  std::error_code ec;
+  if (!ensure_dir(obj.parent_path()))
+    return false;
+  if (fs::exists(meta, ec))
+    return true;
+  const fs::path to = tmp_name(obj), tm = tmp_name(meta);
+  if (!link_or_copy(src, to) || !write_meta(tm, e)) {
+    fs::remove(to, ec);
+    fs::remove(tm, ec);
+    return false;
+  }
+  // 先对象后 meta：fetch 以 meta 存在为准，不会读到半成品
+  fs::rename(to, obj, ec);
+  if (!ec)
+    fs::rename(tm, meta, ec);
+  if (ec) {
+    fs::remove(to, ec);
+    fs::remove(tm, ec);
+    return false;
+  }
+  return true;
+}
+
+size_t ResultCache::trim() {
+  if (max_bytes_ == 0)
+    return 0;
+  std::lock_guard<std::mutex> lk(mu_);
+  struct Item {
+    fs::file_time_type used;
+    uint64_t bytes;
+    fs::path meta, obj;
+  };
+  std::vector<Item> items;
+  uint64_t total = 0;
+  std::error_code ec;
+  for (fs::recursive_directory_iterator it(dir_ / "objects", ec), end;
+       !ec && it != end; it.increment(ec)) {
+    const fs::path &p = it->path();
+    if (p.extension() != ".meta")
+      continue;
+    fs::path obj = p;
+    obj.replace_extension(".mp4");
+    Item i{fs::last_write_time(p, ec), file_size_or(obj), p, obj};
+    total += i.bytes;
+    items.push_back(std::move(i));
+  }
+  if (total <= max_bytes_)
+    return 0;
+  std::sort(items.begin(), items.end(),
+            [](const Item &a, const Item &b) { return a.used < b.used; });
+  size_t removed = 0;
+  for (auto &i : items) {
+    if (total <= max_bytes_)
+      break;
+    fs::remove(i.meta, ec);
+    fs::remove(i.obj, ec);
+    total -= i.bytes;
+    ++removed;
+  }
+  return removed;
+}
+
+std::string ResultCache::input_fingerprint(const fs::path &in, int workers) {
+  return input_fingerprint(
+      in, [&](uint64_t &h) { return hash_file(in, workers, h); });
+}
+
+std::string
+ResultCache::input_fingerprint(const fs::path &in,
+                               const std::function<bool(uint64_t &)> &hash) {
+  std::error_code ec;
+  const fs::path abs = fs::absolute(in, ec);
+  const uint64_t size = file_size_or(in);
+  const auto mtime = (long long)fs::last_write_time(in, ec)
+                         .time_since_epoch()
+                         .count();
+  const fs::path memo =
+      dir_ / "inputs" / (hex64(hash64(abs.generic_string())) + ".txt");
+  {
+    std::ifstream ifs(memo);
+    unsigned long long s = 0;
+    long long m = 0;
+    std::string fp;
+    if (ifs >> s >> m >> fp && s == size && m == mtime)
+      return fp;
+  }
+  uint64_t h = 0;
+  if (!hash(h))
+    return std::string();
+  const std::string fp = hex64(h) + "-" + std::to_string(size);
+  std::ostringstream ss;
+  ss << size << " " << mtime << " " << fp << "\n";
+  const fs::path tmp = tmp_name(memo);
+  if (write_text(tmp, ss.str()))
+    fs::rename(tmp, memo, ec);
+  return fp;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// 结果缓存（内容寻址）：键 = 输入指纹 + 缺陷 + 完整滤镜/编码参数 + ffmpeg 版本。
+// 布局：<dir>/objects/<k[0..1]>/<key>.mp4 与同名 .meta（缺陷、详情、原始计时）；
+// .meta 的修改时间即最近使用时间，trim() 按 LRU 删除直至不超过上限。
+// 命中时优先硬链接到输出目录，跨设备时尝试 reflink（Linux FICLONE），最后回退复制。
+
+struct CacheEntry {
+    std::string kind;
+    std::string details;
+    uint64_t frames=0;
+    double wall_s=0, cpu_s=0, fps=0, speed=0;
+};
+
+class ResultCache {
+public:
+    // max_bytes=0 表示不限大小
+    bool open(const std::filesystem::path& dir, uint64_t max_bytes);
+    const std::filesystem::path& dir() const { return dir_; }
+
+    // 命中时把对象放到 dst 并读出 meta
+    bool fetch(const std::string& key, const std::filesystem::path& dst, CacheEntry& e);
+    // 把 src 存为 key 的对象（原子重命名，已存在则跳过）
+    bool store(const std::string& key, const std::filesystem::path& src, const CacheEntry& e);
+    // 按最近使用时间淘汰，直至总大小 <= 上限；返回删除的对象数
+    size_t trim();
+
+    // 输入指纹（整文件哈希）；按 (路径, 大小, 修改时间) 记在 <dir>/inputs 下，文件未变时不再重算
+    std::string input_fingerprint(const std::filesystem::path& in, int workers);
+    // 同上，未命中记录时由 hash 给出整文件哈希（如复用后台哈希作业的结果，不再读一遍）
+    std::string input_fingerprint(const std::filesystem::path& in,
+                                  const std::function<bool(uint64_t&)>& hash);
+
+private:
+    std::filesystem::path object(const std::string& key, const char* ext) const;
+    std::filesystem::path dir_;
+    uint64_t max_bytes_=0;
+    std::mutex mu_;
+};
+
+// 放置文件：硬链接 -> reflink -> 复制
+bool link_or_copy(const std::filesystem::path& src, const std::filesystem::path& dst);
+
+// ffmpeg -version 的首行（每个可执行文件只查询一次）
+std::string ffmpeg_version(const std::string& ffmpeg);
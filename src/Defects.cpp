@@ -1,5 +1,11 @@
 #include "Defects.hpp"
 #include "Fs.hpp"
+#include "Hash.hpp"
+#include "Jobs.hpp"
+#include "Native.hpp"
+#include "Pipeline.hpp"
+#include "Pool.hpp"
+#include "Telemetry.hpp"
 #include <algorithm>
 #include <cassert>
 #include <chrono>
@@ -8,6 +14,8 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <set>
 #include <sstream>
 #include <vector>
 
@@ -58,70 +66,51 @@ inline bool util_ensure_dir(const fs::path &d) {
     return true;
   return fs::create_directories(d, ec);
 }
-// 执行命令并捕获标准输出；失败返回空串
-inline std::string util_exec_read_all(const std::string &cmd) {
-#ifdef _WIN32
-  FILE *pipe = _popen(cmd.c_str(), "r");
-#else
-  FILE *pipe = popen(cmd.c_str(), "r");
-#endif
-  if (!pipe)
-    return std::string();
-  std::string out;
-  char buf[512];
-  while (true) {
-    size_t n = fread(buf, 1, sizeof(buf), pipe);
-    if (n == 0)
-      break;
-    out.append(buf, buf + n);
-  }
-#ifdef _WIN32
-  _pclose(pipe);
-#else
-  pclose(pipe);
-#endif
-  return out;
+inline bool is_y4m(const Context &ctx) {
+  std::string ext = fs::path(ctx.cfg.in_path).extension().string();
+  for (auto &c : ext)
+    c = (char)std::tolower((unsigned char)c);
+  return ext == ".y4m";
 }
-// 读取首帧 Y 平面的直方图（256 bins）。成功返回 true 并填充 hist
-inline bool probe_luma_hist_first_frame(const Context &ctx,
-                                        std::vector<uint32_t> &hist) {
-  if (ctx.cfg.w <= 0 || ctx.cfg.h <= 0)
-    return false;
-  const size_t y_bytes = (size_t)ctx.cfg.w * (size_t)ctx.cfg.h;
-  std::ifstream ifs(ctx.cfg.in_path, std::ios::binary);
-  if (!ifs)
-    return false;
-  std::vector<unsigned char> buf(y_bytes);
-  ifs.read(reinterpret_cast<char *>(buf.data()), (std::streamsize)y_bytes);
-  if ((size_t)ifs.gcount() != y_bytes)
-    return false;
-  hist.assign(256, 0);
-  for (size_t i = 0; i < y_bytes; ++i) {
-    ++hist[buf[i]];
-  }
-  return true;
+// 每帧字节数；不支持的 pix 按 yuv420p 8-bit 估算
+inline uint64_t frame_bytes(const Context &ctx) {
+  return ctx.geo.valid() ? ctx.geo.frame_bytes
+                         : (uint64_t)ctx.cfg.w * ctx.cfg.h * 3 / 2;
 }
-// 读取首帧 Y 平面，返回最大亮度（8-bit）。失败返回 -1。
-inline int probe_luma_max_first_frame(const Context &ctx) {
-  if (ctx.cfg.w <= 0 || ctx.cfg.h <= 0)
-    return -1;
-  const size_t y_bytes = (size_t)ctx.cfg.w * (size_t)ctx.cfg.h;
-  std::ifstream ifs(ctx.cfg.in_path, std::ios::binary);
-  if (!ifs)
-    return -1;
-  std::vector<unsigned char> buf(y_bytes);
-  ifs.read(reinterpret_cast<char *>(buf.data()), (std::streamsize)y_bytes);
-  if ((size_t)ifs.gcount() != y_bytes)
-    return -1;
-  int m = 0;
-  for (size_t i = 0; i < y_bytes; ++i) {
-    if (buf[i] > m)
-      m = buf[i];
-  }
-  return m;
+inline bool windowed(const Context &ctx) {
+  return ctx.cfg.start > 0 || ctx.cfg.frames > 0;
+}
+// 以只读映射打开输入（零拷贝帧访问）；y4m 通过帧偏移索引定位。
+// 有帧窗口时帧号相对窗口起点
+inline bool open_source(const Context &ctx, FrameSource &src) {
+  if (!ctx.geo.valid())
+    return false;
+  const bool ok =
+      is_y4m(ctx)
+          ? ctx.y4m && ctx.y4m->offsets &&
+                src.open_indexed(ctx.cfg.in_path, ctx.geo, ctx.y4m->offsets)
+          : src.open(ctx.cfg.in_path, ctx.geo);
+  if (ok && windowed(ctx))
+    src.set_window(ctx.cfg.start, ctx.total_frames);
+  return ok;
 }
 } // namespace
 
+static std::shared_ptr<ResultCache> shared_cache(const fs::path &dir,
+                                                 uint64_t max_bytes) {
+  static std::mutex mu;
+  static std::map<string, std::shared_ptr<ResultCache>> open;
+  std::lock_guard<std::mutex> lk(mu);
+  auto &c = open[pstr(fs::absolute(dir))];
+  if (!c) {
+    auto rc = std::make_shared<ResultCache>();
+    if (!rc->open(dir, max_bytes))
+      return nullptr;
+    c = rc;
+  }
+  return c;
+}
+
 bool init_context(Context &ctx) {
   fs::path in(ctx.cfg.in_path);
   if (!fs::exists(in)) {
@@ -137,6 +126,7 @@ bool init_context(Context &ctx) {
                        .count();
   }
   ctx.rng.seed(ctx.cfg.seed);
+  ctx.stats = std::make_shared<StatsCache>();
 
   if (ctx.cfg.out_dir.empty()) {
     ctx.cfg.out_dir = fs::path("out_" + ts_now());
@@ -146,22 +136,39 @@ bool init_context(Context &ctx) {
     return false;
   }
 
-  // 估算总帧数：raw 走尺寸估算；y4m 用 ffprobe 读取真实帧数
-  std::string ext = in.extension().string();
-  for (auto &c : ext)
-    c = (char)std::tolower((unsigned char)c);
-  if (ext == ".y4m") {
+  // y4m：由流头得到尺寸/帧率/像素格式，并扫描 FRAME 建立帧偏移索引
+  Y4mInfo y4m;
+  if (is_y4m(ctx) && y4m_probe(in, y4m)) {
+    if ((ctx.cfg.w > 0 && ctx.cfg.w != y4m.w) ||
+        (ctx.cfg.h > 0 && ctx.cfg.h != y4m.h))
+      std::cerr << "[warn] -r overridden by y4m header: " << y4m.w << "x"
+                << y4m.h << "\n";
+    ctx.cfg.w = y4m.w;
+    ctx.cfg.h = y4m.h;
+    if (!y4m.pix.empty())
+      ctx.cfg.pix = y4m.pix;
+    if (y4m.fps_num > 0 && y4m.fps_den > 0) {
+      ctx.cfg.fps = (int)((y4m.fps_num + y4m.fps_den / 2) / y4m.fps_den);
+      ctx.rate = std::to_string(y4m.fps_num) + "/" +
+                 std::to_string(y4m.fps_den);
+    }
+    ctx.y4m = std::make_shared<const Y4mInfo>(std::move(y4m));
+  }
+  if (ctx.rate.empty())
+    ctx.rate = std::to_string(ctx.cfg.fps);
+
+  // 平面几何（8-bit planar）；不支持的 pix 留空，仅走 ffmpeg 路径
+  frame_geometry(ctx.cfg.w, ctx.cfg.h, ctx.cfg.pix, ctx.geo);
+
+  // 估算总帧数：raw 走尺寸估算；y4m 取索引帧数，无索引时回退 ffprobe
+  if (ctx.y4m && ctx.y4m->offsets) {
+    ctx.total_frames = ctx.y4m->offsets->size();
+  } else if (is_y4m(ctx)) {
     // 使用 ffprobe 统计帧数，并丢弃 stderr，避免参数解析噪声
-    std::string cmd = ctx.cfg.ffprobe +
-                      " -v error -select_streams v:0 -count_packets "
-                      "-show_entries stream=nb_read_packets -of csv=p=0 \"" +
-                      fs::absolute(in).string() + "\"";
-#ifdef _WIN32
-    cmd += " 2> NUL";
-#else
-    cmd += " 2>/dev/null";
-#endif
-    std::string out = util_exec_read_all(cmd);
+    std::string out = exec_read_all(
+        {ctx.cfg.ffprobe, "-v", "error", "-select_streams", "v:0",
+         "-count_packets", "-show_entries", "stream=nb_read_packets", "-of",
+         "csv=p=0", fs::absolute(in).string()});
     // 修剪空白
     while (!out.empty() && (out.back() == '\n' || out.back() == '\r' ||
                             out.back() == ' ' || out.back() == '\t'))
@@ -178,18 +185,86 @@ bool init_context(Context &ctx) {
       ctx.total_frames = 0;
     }
   } else {
-    if (ctx.cfg.pix != "yuv420p") {
+    const uint64_t bytes_per_frame = frame_bytes(ctx);
+    if (!ctx.geo.valid())
       std::cerr << "[warn] frame count estimation assumes yuv420p 8-bit.\n";
-    }
-    const uint64_t bytes_per_frame = (uint64_t)ctx.cfg.w * ctx.cfg.h * 3 / 2;
     const uint64_t sz = util_file_size_or(in);
     ctx.total_frames =
         (bytes_per_frame > 0) ? (size_t)(sz / bytes_per_frame) : 0;
   }
 
+  // 帧窗口：此后 total_frames 为窗口帧数
+  if (windowed(ctx)) {
+    if (ctx.total_frames > 0 && ctx.cfg.start >= ctx.total_frames) {
+      std::cerr << "--start " << ctx.cfg.start << " is past the end ("
+                << ctx.total_frames << " frames)\n";
+      return false;
+    }
+    const size_t avail =
+        ctx.total_frames > 0 ? ctx.total_frames - ctx.cfg.start : 0;
+    ctx.total_frames = ctx.cfg.frames == 0 ? avail
+                       : avail == 0        ? ctx.cfg.frames
+                                           : std::min(ctx.cfg.frames, avail);
+  }
+
+  // 输入指纹：后台逐帧哈希，与统计分析/编码重叠，写 manifest 前才等待结果；
+  // 有帧窗口时只哈希窗口内的帧。y4m 无帧索引（C 标记不支持或索引失败）时
+  // 不能按 frame_bytes 切分，只算整文件哈希
+  const bool y4m_unindexed = is_y4m(ctx) && !(ctx.y4m && ctx.y4m->offsets);
+  if (ctx.cfg.fingerprint)
+    ctx.hashes = hash_input_async(
+        in, y4m_unindexed ? FrameGeometry{} : ctx.geo,
+        ctx.y4m ? ctx.y4m->offsets : nullptr,
+        std::clamp(available_cpus() / 4, 1, 4), ctx.cfg.start,
+        windowed(ctx) ? std::max<size_t>(ctx.total_frames, 1) : 0);
+
+  // 结果缓存：同一目录在进程内共用一个实例（批处理时各片段共享 LRU）
+  if (!ctx.cfg.cache_dir.empty()) {
+    ctx.cache = shared_cache(ctx.cfg.cache_dir, ctx.cfg.cache_max);
+    // 后台作业已在哈希整个文件时直接取其结果，避免再读一遍输入
+    if (ctx.cache && ctx.hashes && !windowed(ctx))
+      ctx.input_fp = ctx.cache->input_fingerprint(in, [&](uint64_t &h) {
+        const InputHashes &r = ctx.hashes->wait();
+        h = r.file;
+        return r.ok;
+      });
+    else if (ctx.cache)
+      ctx.input_fp = ctx.cache->input_fingerprint(in, hw_threads());
+    if (!ctx.cache || ctx.input_fp.empty()) {
+      std::cerr << "[warn] result cache disabled for " << pstr(in) << "\n";
+      ctx.cache.reset();
+    }
+  }
+
   return true;
 }
 
+const ClipStats *clip_stats(const Context &ctx) {
+  if (!ctx.stats)
+    return nullptr;
+  std::call_once(ctx.stats->once, [&] {
+    FrameSource src;
+    if (!open_source(ctx, src) || src.frame_count() == 0)
+      return;
+    const size_t step = stats_step_for(src.frame_count(), ctx.cfg.stats_step);
+    string key = stats_key(ctx.cfg.in_path, ctx.geo, step);
+    if (windowed(ctx))
+      key += " window=" + std::to_string(ctx.cfg.start) + "+" +
+             std::to_string(ctx.total_frames);
+    // 优先放在输入旁边；输入目录不可写时退回输出目录
+    const fs::path side_in = fs::path(ctx.cfg.in_path).concat(".ycstats");
+    const fs::path side_out = ctx.cfg.out_dir / (ctx.base + ".ycstats");
+    auto cs = std::make_unique<ClipStats>();
+    if (!load_stats(side_in, key, *cs) && !load_stats(side_out, key, *cs)) {
+      *cs = compute_clip_stats(src, step, hw_threads());
+      if (!save_stats(side_in, key, *cs))
+        save_stats(side_out, key, *cs);
+    }
+    ctx.stats->value = std::move(cs);
+  });
+  return ctx.stats->value.get();
+}
+
 string rand_suffix(Context &ctx) {
   std::uniform_int_distribution<int> d(0, 25);
   char a = 'a' + d(ctx.rng);
@@ -202,69 +277,96 @@ static string outname(const Context &ctx, const string &suf) {
   return ctx.base + "_" + suf + ".mp4";
 }
 
-static std::vector<string> base_in_args(const Context &ctx) {
+// 原生路径的偶数尺寸修正：尺寸已为偶数时不再经过 scale
+static string native_scale_vf(const Context &ctx) {
+  if (ctx.cfg.w % 2 == 0 && ctx.cfg.h % 2 == 0)
+    return string();
+  return "scale=trunc(iw/2)*2:trunc(ih/2)*2";
+}
+
+static std::vector<string> base_in_args(const Context &ctx, size_t skip = 0) {
   // 对 .y4m 输入：直接让 ffmpeg 自识别容器与元数据；
   // 对 raw YUV：显式提供 -s/-pix_fmt/-r/-f rawvideo
+  // 帧窗口：raw 按字节偏移跳过，y4m 按帧时间戳定位（提前半帧，避免取整丢帧）
+  // skip：在窗口起点之后再跳过的帧数（帧段模式）
   std::vector<string> args{ctx.cfg.ffmpeg, "-hide_banner", "-y"};
   std::filesystem::path pin(ctx.cfg.in_path);
-  std::string ext = pin.extension().string();
-  for (auto &c : ext)
-    c = (char)std::tolower((unsigned char)c);
-  if (ext == ".y4m") {
+  const size_t first = ctx.cfg.start + skip;
+  if (is_y4m(ctx)) {
+    if (first > 0) {
+      const double num = ctx.y4m ? ctx.y4m->fps_num : ctx.cfg.fps;
+      const double den = ctx.y4m ? ctx.y4m->fps_den : 1;
+      std::ostringstream ss;
+      ss << std::fixed << std::setprecision(6)
+         << ((double)first - 0.5) * den / num;
+      args.insert(args.end(), {"-ss", ss.str()});
+    }
     args.insert(args.end(), {"-i", pstr(fs::absolute(pin))});
   } else {
     args.insert(args.end(),
                 {"-s",
                  std::to_string(ctx.cfg.w) + "x" + std::to_string(ctx.cfg.h),
                  "-pix_fmt", ctx.cfg.pix, "-r", std::to_string(ctx.cfg.fps),
-                 "-f", "rawvideo", "-i", pstr(fs::absolute(pin))});
+                 "-f", "rawvideo"});
+    if (first > 0)
+      args.insert(args.end(),
+                  {"-skip_initial_bytes",
+                   std::to_string((uint64_t)first * frame_bytes(ctx))});
+    args.insert(args.end(), {"-i", pstr(fs::absolute(pin))});
   }
   return args;
 }
 
-bool make_blocky(Context &ctx, std::vector<OutFile> &outs) {
-  // 低码率+快速预设：通过编码器压缩产生块状/马赛克伪影（更贴近解码/传输失真）
-  string vf = "scale=trunc(iw/2)*2:trunc(ih/2)*2"; // 保证偶数尺寸
-  string suf = rand_suffix(ctx);
-  string out = pstr(fs::absolute(ctx.cfg.out_dir / outname(ctx, suf)));
+// 帧窗口的输出帧数上限（紧跟各输出的编码参数）
+static void add_window_out(std::vector<string> &cmd, const Context &ctx) {
+  if (windowed(ctx) && ctx.total_frames > 0)
+    cmd.insert(cmd.end(), {"-frames:v", std::to_string(ctx.total_frames)});
+}
 
-  auto cmd = base_in_args(ctx);
-  cmd.insert(cmd.end(), {"-vf", vf, "-c:v", "libx264", "-b:v", "500k",
-                         "-preset", "veryfast", out});
-  if (run_cmd(cmd) != 0) {
-    outs.push_back(
-        {fs::path(out).filename().string(), "bitrate_blocky", "FAILED"});
-    return false;
+// enable 表达式： between(n,a,b)+between(n,c,d)+...；帧号减去 off
+static string span_enable(const std::vector<std::pair<int, int>> &spans,
+                          int off) {
+  std::ostringstream en;
+  for (size_t i = 0; i < spans.size(); ++i) {
+    if (i)
+      en << " + ";
+    en << "between(n\\," << spans[i].first - off << "\\,"
+       << spans[i].second - off << ")";
   }
+  return en.str();
+}
 
-  outs.push_back({fs::path(out).filename().string(), "bitrate_blocky",
-                  "b=500k preset=veryfast"});
-  return true;
+DefectPlan plan_blocky(Context &ctx) {
+  // 低码率+快速预设：通过编码器压缩产生块状/马赛克伪影（更贴近解码/传输失真）
+  DefectPlan p;
+  p.kind = "bitrate_blocky";
+  p.vf = "scale=trunc(iw/2)*2:trunc(ih/2)*2"; // 保证偶数尺寸
+  p.filename = outname(ctx, rand_suffix(ctx));
+  p.enc_args = {"-c:v", "libx264", "-b:v", "500k", "-preset", "veryfast"};
+  p.details = "b=500k preset=veryfast";
+  return p;
 }
 
-bool make_brightness(Context &ctx, std::vector<OutFile> &outs) {
+DefectPlan plan_brightness(Context &ctx) {
   // 微亮度偏移：-3..+3（8-bit）
   std::uniform_int_distribution<int> d(-3, 3);
   int delta = d(ctx.rng);
-  string vf = "lutyuv=y='clip(val+" + std::to_string(delta) +
-              ",0,255)',scale=trunc(iw/2)*2:trunc(ih/2)*2";
-  string suf = rand_suffix(ctx);
-  string out = pstr(fs::absolute(ctx.cfg.out_dir / outname(ctx, suf)));
-
-  auto cmd = base_in_args(ctx);
-  cmd.insert(cmd.end(), {"-vf", vf, "-c:v", "libx264", "-crf", "22", out});
-  if (run_cmd(cmd) != 0) {
-    outs.push_back(
-        {fs::path(out).filename().string(), "brightness_drift", "FAILED"});
-    return false;
-  }
-
-  outs.push_back({fs::path(out).filename().string(), "brightness_drift",
-                  "delta_Y=" + std::to_string(delta) + " (global)"});
-  return true;
+  DefectPlan p;
+  p.kind = "brightness_drift";
+  p.vf = "lutyuv=y='clip(val+" + std::to_string(delta) +
+         ",0,255)',scale=trunc(iw/2)*2:trunc(ih/2)*2";
+  p.filename = outname(ctx, rand_suffix(ctx));
+  p.enc_args = {"-c:v", "libx264", "-crf", "22"};
+  p.details = "delta_Y=" + std::to_string(delta) + " (global)";
+  uint8_t lut[256];
+  for (int v = 0; v < 256; ++v)
+    lut[v] = (uint8_t)std::min(255, std::max(0, v + delta));
+  p.native = std::make_shared<LutStage>(lut);
+  p.native_vf = native_scale_vf(ctx);
+  return p;
 }
 
-bool make_jitter(Context &ctx, std::vector<OutFile> &outs) {
+DefectPlan plan_jitter(Context &ctx) {
   // 轻微抖动：每 K 帧触发两帧“往返”抖动（±1px），pad 黑边后裁回，保证分辨率一致
   std::uniform_int_distribution<int> dk(5, 10);
   std::uniform_int_distribution<int> ds(0, 1); // 0:h, 1:v
@@ -312,111 +414,95 @@ bool make_jitter(Context &ctx, std::vector<OutFile> &outs) {
   std::ostringstream finalvf;
   finalvf << "format=yuv444p," << vfoss.str()
           << ",format=yuv420p,scale=trunc(iw/2)*2:trunc(ih/2)*2";
-  string vf = finalvf.str();
 
-  string suf = rand_suffix(ctx);
-  string out = pstr(fs::absolute(ctx.cfg.out_dir / outname(ctx, suf)));
-  auto cmd = base_in_args(ctx);
-  cmd.insert(cmd.end(), {"-vf", vf, "-c:v", "libx264", "-crf", "22", out});
-  if (run_cmd(cmd) != 0) {
-    outs.push_back({fs::path(out).filename().string(), "jitter_1px", "FAILED"});
-    return false;
-  }
+  DefectPlan p;
+  p.kind = "jitter_1px";
+  p.vf = finalvf.str();
+  p.filename = outname(ctx, rand_suffix(ctx));
+  p.enc_args = {"-c:v", "libx264", "-crf", "22"};
+  // 原生路径：直接在 4:2:0 平面上平移触发帧，其余帧零拷贝
+  p.native = std::make_shared<JitterStage>(ctx.geo, K, horiz, forward);
+  p.native_vf = native_scale_vf(ctx);
 
   std::ostringstream det;
   det << (horiz ? "dir=horiz" : "dir=vert")
       << ", wrap=on, shift=1px, period=" << K << ", sense="
       << (forward ? (horiz ? "right" : "down") : (horiz ? "left" : "up"));
-  outs.push_back({fs::path(out).filename().string(), "jitter_1px", det.str()});
-  return true;
+  p.details = det.str();
+  return p;
 }
 
-bool make_smooth(Context &ctx, std::vector<OutFile> &outs) {
+DefectPlan plan_smooth(Context &ctx) {
   // 轻度平滑（尽量不毁纹理，强调边缘平滑）：gblur 小 sigma
   std::uniform_real_distribution<double> ds(0.7, 1.4);
   double sigma = ds(ctx.rng);
   std::ostringstream vf;
   vf << "gblur=sigma=" << std::fixed << std::setprecision(2) << sigma
      << ",scale=trunc(iw/2)*2:trunc(ih/2)*2";
-  string suf = rand_suffix(ctx);
-  string out = pstr(fs::absolute(ctx.cfg.out_dir / outname(ctx, suf)));
 
-  auto cmd = base_in_args(ctx);
-  cmd.insert(cmd.end(),
-             {"-vf", vf.str(), "-c:v", "libx264", "-crf", "23", out});
-  if (run_cmd(cmd) != 0) {
-    outs.push_back(
-        {fs::path(out).filename().string(), "edge_oversmooth", "FAILED"});
-    return false;
-  }
+  DefectPlan p;
+  p.kind = "edge_oversmooth";
+  p.vf = vf.str();
+  p.filename = outname(ctx, rand_suffix(ctx));
+  p.enc_args = {"-c:v", "libx264", "-crf", "23"};
+  // 原生路径：各平面同一 sigma 的可分离高斯
+  p.native = std::make_shared<SpatialStage>(gauss_op(sigma), gauss_op(sigma));
+  p.native_vf = native_scale_vf(ctx);
 
   std::ostringstream d;
   d << "sigma=" << std::setprecision(2) << sigma;
-  outs.push_back(
-      {fs::path(out).filename().string(), "edge_oversmooth", d.str()});
-  return true;
+  p.details = d.str();
+  return p;
 }
 
-bool make_highclip(Context &ctx, std::vector<OutFile> &outs) {
+DefectPlan plan_highclip(Context &ctx) {
   // 高光裁剪：自适应阈值，尽量确保至少某些区域被 clip
-  int y_max = probe_luma_max_first_frame(ctx);
+  // 阈值取自整段（采样）Y 直方图，避免首帧为片头/黑场时失准
+  const ClipStats *cs = clip_stats(ctx);
+  int y_max = cs ? cs->total.p[0].max : -1;
   int T = 240; // 回退默认
   if (y_max >= 2) {
-    // 先尝试基于直方图的 top-X%（1%~5%）定位阈值，确保“大片”高光区域被裁剪
-    std::vector<uint32_t> hist;
-    if (probe_luma_hist_first_frame(ctx, hist)) {
-      uint64_t total = 0;
-      for (uint32_t v : hist)
-        total += v;
-      // 仅针对 Y<250 的像素，选择“最亮约 1%”分位点为阈值，确保被裁剪像素来自
-      // <250
-      uint64_t sum_lt250 = 0;
-      for (int i = 0; i < 250; ++i)
-        sum_lt250 += hist[i];
-      if (sum_lt250 > 0) {
-        const double target = 0.01;
-        const uint64_t cutoff_lt = (uint64_t)(sum_lt250 * (1.0 - target));
-        uint64_t acc_lt = 0;
-        int cdf_idx_lt = 249;
-        for (int i = 0; i < 250; ++i) {
-          acc_lt += hist[i];
-          if (acc_lt >= cutoff_lt) {
-            cdf_idx_lt = i;
-            break;
-          }
+    const auto &hist = cs->total.p[0].hist;
+    // 仅针对 Y<250 的像素，选择“最亮约 1%”分位点为阈值，确保被裁剪像素来自
+    // <250
+    uint64_t sum_lt250 = 0;
+    for (int i = 0; i < 250; ++i)
+      sum_lt250 += hist[i];
+    if (sum_lt250 > 0) {
+      const double target = 0.01;
+      const uint64_t cutoff_lt = (uint64_t)(sum_lt250 * (1.0 - target));
+      uint64_t acc_lt = 0;
+      int cdf_idx_lt = 249;
+      for (int i = 0; i < 250; ++i) {
+        acc_lt += hist[i];
+        if (acc_lt >= cutoff_lt) {
+          cdf_idx_lt = i;
+          break;
         }
-        int chosen = cdf_idx_lt; // [0..249]
-        T = std::max(8, std::min(249, chosen));
-      } else {
-        // 若首帧不存在 Y<250 像素，则退化到接近 y_max 的轻微裁剪，仍限制到 249
-        T = std::min(249, std::max(8, y_max - 1));
       }
+      int chosen = cdf_idx_lt; // [0..249]
+      T = std::max(8, std::min(249, chosen));
     } else {
-      int lower = std::max(10, y_max - 40);
-      int upper = std::min(250, std::max(lower + 1, y_max - 1));
-      std::uniform_int_distribution<int> th(lower, upper);
-      T = th(ctx.rng);
+      // 若不存在 Y<250 像素，则退化到接近 y_max 的轻微裁剪，仍限制到 249
+      T = std::min(249, std::max(8, y_max - 1));
     }
   }
-  string vf = "lutyuv=y='if(gte(val\\," + std::to_string(T) +
-              ")\\,255\\,val)',scale=trunc(iw/2)*2:trunc(ih/2)*2";
-  string suf = rand_suffix(ctx);
-  string out = pstr(fs::absolute(ctx.cfg.out_dir / outname(ctx, suf)));
-
-  auto cmd = base_in_args(ctx);
-  cmd.insert(cmd.end(), {"-vf", vf, "-c:v", "libx264", "-crf", "22", out});
-  if (run_cmd(cmd) != 0) {
-    outs.push_back(
-        {fs::path(out).filename().string(), "highlight_clip", "FAILED"});
-    return false;
-  }
-
-  outs.push_back({fs::path(out).filename().string(), "highlight_clip",
-                  "Y_threshold=" + std::to_string(T)});
-  return true;
+  DefectPlan p;
+  p.kind = "highlight_clip";
+  p.vf = "lutyuv=y='if(gte(val\\," + std::to_string(T) +
+         ")\\,255\\,val)',scale=trunc(iw/2)*2:trunc(ih/2)*2";
+  p.filename = outname(ctx, rand_suffix(ctx));
+  p.enc_args = {"-c:v", "libx264", "-crf", "22"};
+  p.details = "Y_threshold=" + std::to_string(T);
+  uint8_t lut[256];
+  for (int v = 0; v < 256; ++v)
+    lut[v] = v >= T ? 255 : (uint8_t)v;
+  p.native = std::make_shared<LutStage>(lut);
+  p.native_vf = native_scale_vf(ctx);
+  return p;
 }
 
-bool make_chroma_bleed(Context &ctx, std::vector<OutFile> &outs) {
+DefectPlan plan_chroma_bleed(Context &ctx) {
   // 在若干短帧段制造色度错位（chroma-bleeding）
   if (ctx.total_frames == 0) {
     std::cerr << "[warn] total_frames unknown; assuming short video\n";
@@ -444,34 +530,25 @@ bool make_chroma_bleed(Context &ctx, std::vector<OutFile> &outs) {
   int cbh = shiftH(ctx.rng), crh = -shiftH(ctx.rng);
   int cbv = shiftV(ctx.rng), crv = -shiftV(ctx.rng);
 
-  // enable 表达式： between(n,a,b)+between(n,c,d)+...
-  std::ostringstream en;
-  for (size_t i = 0; i < spans.size(); ++i) {
-    if (i)
-      en << " + ";
-    en << "between(n\\," << spans[i].first << "\\," << spans[i].second << ")";
-  }
-
   // chromashift + 轻度 chroma 模糊
-  std::ostringstream vf;
-  vf << "chromashift=cbh=" << cbh << ":crh=" << crh << ":cbv=" << cbv
-     << ":crv=" << crv << ":enable='" << en.str()
-     << "',"
-     // 加强色度模糊以扩大“溢出”观感
-     << "boxblur=0:2:enable='" << en.str() << "',"
-     << "scale=trunc(iw/2)*2:trunc(ih/2)*2";
+  auto vf_at = [=](int off) {
+    const string en = span_enable(spans, off);
+    std::ostringstream vf;
+    vf << "chromashift=cbh=" << cbh << ":crh=" << crh << ":cbv=" << cbv
+       << ":crv=" << crv << ":enable='" << en
+       << "',"
+       // 加强色度模糊以扩大“溢出”观感
+       << "boxblur=0:2:enable='" << en << "',"
+       << "scale=trunc(iw/2)*2:trunc(ih/2)*2";
+    return vf.str();
+  };
 
-  string suf = rand_suffix(ctx);
-  string out = pstr(fs::absolute(ctx.cfg.out_dir / outname(ctx, suf)));
-
-  auto cmd = base_in_args(ctx);
-  cmd.insert(cmd.end(),
-             {"-vf", vf.str(), "-c:v", "libx264", "-crf", "22", out});
-  if (run_cmd(cmd) != 0) {
-    outs.push_back(
-        {fs::path(out).filename().string(), "chroma_bleed", "FAILED"});
-    return false;
-  }
+  DefectPlan p;
+  p.kind = "chroma_bleed";
+  p.vf = vf_at(0);
+  p.vf_at = vf_at;
+  p.filename = outname(ctx, rand_suffix(ctx));
+  p.enc_args = {"-c:v", "libx264", "-crf", "22"};
 
   std::ostringstream det;
   det << "frames=";
@@ -482,12 +559,17 @@ bool make_chroma_bleed(Context &ctx, std::vector<OutFile> &outs) {
   }
   det << " cb_h=" << cbh << " cr_h=" << crh << " cb_v=" << cbv
       << " cr_v=" << crv << " (both Cb/Cr shifted)";
-  outs.push_back(
-      {fs::path(out).filename().string(), "chroma_bleed", det.str()});
-  return true;
+  p.details = det.str();
+  p.spans = spans;
+  const std::pair<int, int> shift[2] = {{cbh, cbv}, {crh, crv}};
+  // boxblur=0:2 中 2 是亮度 power，色度半径沿用亮度半径 0，实际不模糊；
+  // 原生阶段同样取半径 0，与 ffmpeg 路径逐帧一致
+  p.native = std::make_shared<ChromaBleedStage>(shift, 0, spans);
+  p.native_vf = native_scale_vf(ctx);
+  return p;
 }
 
-bool make_luma_bleed(Context &ctx, std::vector<OutFile> &outs) {
+DefectPlan plan_luma_bleed(Context &ctx) {
   // 与 chroma_bleed 一致：在若干短帧段内启用轻度亮度拖影（ghosting-like）
   if (ctx.total_frames == 0) {
     std::cerr << "[warn] total_frames unknown; assuming short video\n";
@@ -514,30 +596,23 @@ bool make_luma_bleed(Context &ctx, std::vector<OutFile> &outs) {
   double sigma = sigmaR(ctx.rng);
   double opacity = opR(ctx.rng);
 
-  // enable 表达式： between(n,a,b)+between(n,c,d)+...
-  std::ostringstream en;
-  for (size_t i = 0; i < spans.size(); ++i) {
-    if (i)
-      en << " + ";
-    en << "between(n\\," << spans[i].first << "\\," << spans[i].second << ")";
-  }
-
   // 构建滤镜链：分流 -> 模糊 -> 混合（仅在 spans 启用）
-  std::ostringstream vf;
-  vf << "split[y][tmp];[tmp]gblur=sigma=" << std::fixed << std::setprecision(2)
-     << sigma << "[blur];[y][blur]blend=all_mode=average:all_opacity="
-     << std::setprecision(2) << opacity << ":enable='" << en.str()
-     << "',scale=trunc(iw/2)*2:trunc(ih/2)*2";
+  auto vf_at = [=](int off) {
+    std::ostringstream vf;
+    vf << "split[y][tmp];[tmp]gblur=sigma=" << std::fixed
+       << std::setprecision(2) << sigma
+       << "[blur];[y][blur]blend=all_mode=average:all_opacity="
+       << std::setprecision(2) << opacity << ":enable='"
+       << span_enable(spans, off) << "',scale=trunc(iw/2)*2:trunc(ih/2)*2";
+    return vf.str();
+  };
 
-  string suf = rand_suffix(ctx);
-  string out = pstr(fs::absolute(ctx.cfg.out_dir / outname(ctx, suf)));
-  auto cmd = base_in_args(ctx);
-  cmd.insert(cmd.end(),
-             {"-vf", vf.str(), "-c:v", "libx264", "-crf", "22", out});
-  if (run_cmd(cmd) != 0) {
-    outs.push_back({fs::path(out).filename().string(), "luma_bleed", "FAILED"});
-    return false;
-  }
+  DefectPlan p;
+  p.kind = "luma_bleed";
+  p.vf = vf_at(0);
+  p.vf_at = vf_at;
+  p.filename = outname(ctx, rand_suffix(ctx));
+  p.enc_args = {"-c:v", "libx264", "-crf", "22"};
 
   std::ostringstream det;
   det << "frames=";
@@ -548,11 +623,14 @@ bool make_luma_bleed(Context &ctx, std::vector<OutFile> &outs) {
   }
   det << " sigma=" << std::setprecision(2) << sigma
       << " opacity=" << std::setprecision(2) << opacity;
-  outs.push_back({fs::path(out).filename().string(), "luma_bleed", det.str()});
-  return true;
+  p.details = det.str();
+  p.spans = spans;
+  p.native = std::make_shared<BleedStage>(sigma, opacity, spans);
+  p.native_vf = native_scale_vf(ctx);
+  return p;
 }
 
-bool make_grain(Context &ctx, std::vector<OutFile> &outs) {
+DefectPlan plan_grain(Context &ctx) {
   // 添加轻度胶片颗粒：noise + 轻微 sharpen，保持偶数尺寸
   std::uniform_int_distribution<int> nstr(2, 6); // 基础强度 2..6
   int s = nstr(ctx.rng) * 5;                     // 转为 10..30 更可见
@@ -561,39 +639,40 @@ bool make_grain(Context &ctx, std::vector<OutFile> &outs) {
   vf << "noise=alls=" << s << ":allf=t+u:all_seed=" << allowedSeed
      << ",unsharp=lx=3:ly=3:la=0.2:cx=3:cy=3:ca=0.0,scale=trunc(iw/"
         "2)*2:trunc(ih/2)*2";
-  string suf = rand_suffix(ctx);
-  string out = pstr(fs::absolute(ctx.cfg.out_dir / outname(ctx, suf)));
-  auto cmd = base_in_args(ctx);
-  cmd.insert(cmd.end(),
-             {"-vf", vf.str(), "-c:v", "libx264", "-crf", "22", out});
-  if (run_cmd(cmd) != 0) {
-    outs.push_back({fs::path(out).filename().string(), "grain", "FAILED"});
-    return false;
-  }
-  outs.push_back({fs::path(out).filename().string(), "grain", "noise+unsharp"});
-  return true;
+  DefectPlan p;
+  p.kind = "grain";
+  p.vf = vf.str();
+  p.filename = outname(ctx, rand_suffix(ctx));
+  p.enc_args = {"-c:v", "libx264", "-crf", "22"};
+  p.details = "noise+unsharp strength=" + std::to_string(s);
+  // 原生路径：计数器哈希颗粒（用完整 64 位种子，不截断）+ Y 平面 3x3 反锐化
+  p.native = std::make_shared<ChainStage>(
+      std::vector<std::shared_ptr<NativeStage>>{
+          std::make_shared<GrainStage>(ctx.cfg.seed, s),
+          std::make_shared<SpatialStage>(unsharp_op(3, 0.2), SpatialOp())});
+  p.native_vf = native_scale_vf(ctx);
+  return p;
 }
 
-bool make_ringing(Context &ctx, std::vector<OutFile> &outs) {
+DefectPlan plan_ringing(Context &ctx) {
   // 模拟振铃：先锐化再轻度去块，或通过 oversharp + deblock
-  std::ostringstream vf;
-  vf << "unsharp=lx=5:ly=5:la=1.2:cx=5:cy=5:ca=0.6,deblock=alpha=0.2:beta=0.2,"
-        "scale=trunc(iw/2)*2:trunc(ih/2)*2";
-  string suf = rand_suffix(ctx);
-  string out = pstr(fs::absolute(ctx.cfg.out_dir / outname(ctx, suf)));
-  auto cmd = base_in_args(ctx);
-  cmd.insert(cmd.end(),
-             {"-vf", vf.str(), "-c:v", "libx264", "-crf", "22", out});
-  if (run_cmd(cmd) != 0) {
-    outs.push_back({fs::path(out).filename().string(), "ringing", "FAILED"});
-    return false;
-  }
-  outs.push_back(
-      {fs::path(out).filename().string(), "ringing", "unsharp+deblock"});
-  return true;
+  DefectPlan p;
+  p.kind = "ringing";
+  p.vf = "unsharp=lx=5:ly=5:la=1.2:cx=5:cy=5:ca=0.6,deblock=alpha=0.2:beta=0.2,"
+         "scale=trunc(iw/2)*2:trunc(ih/2)*2";
+  p.filename = outname(ctx, rand_suffix(ctx));
+  p.enc_args = {"-c:v", "libx264", "-crf", "22"};
+  p.details = "unsharp+deblock";
+  // 原生做 5x5 反锐化，去块仍交给 ffmpeg
+  p.native = std::make_shared<SpatialStage>(unsharp_op(5, 1.2),
+                                            unsharp_op(5, 0.6));
+  p.native_vf = "deblock=alpha=0.2:beta=0.2";
+  if (!native_scale_vf(ctx).empty())
+    p.native_vf += "," + native_scale_vf(ctx);
+  return p;
 }
 
-bool make_banding(Context &ctx, std::vector<OutFile> &outs) {
+DefectPlan plan_banding(Context &ctx) {
   // 模拟色带：降低量化或抬升 posterize，在 Y 通道减少级别，再适度模糊
   std::uniform_int_distribution<int> pow2(3, 6); // 2^3=8 .. 2^6=64
   int levels = 1 << pow2(ctx.rng);
@@ -601,44 +680,48 @@ bool make_banding(Context &ctx, std::vector<OutFile> &outs) {
   vf << "lutyuv=y='trunc(val/" << levels << ")*" << levels
      << "',gblur=sigma=0.4,"
      << "scale=trunc(iw/2)*2:trunc(ih/2)*2";
-  string suf = rand_suffix(ctx);
-  string out = pstr(fs::absolute(ctx.cfg.out_dir / outname(ctx, suf)));
-  auto cmd = base_in_args(ctx);
-  cmd.insert(cmd.end(),
-             {"-vf", vf.str(), "-c:v", "libx264", "-crf", "22", out});
-  if (run_cmd(cmd) != 0) {
-    outs.push_back({fs::path(out).filename().string(), "banding", "FAILED"});
-    return false;
-  }
-  outs.push_back({fs::path(out).filename().string(), "banding",
-                  std::string("levels=") + std::to_string(levels)});
-  return true;
+  DefectPlan p;
+  p.kind = "banding";
+  p.vf = vf.str();
+  p.filename = outname(ctx, rand_suffix(ctx));
+  p.enc_args = {"-c:v", "libx264", "-crf", "22"};
+  p.details = std::string("levels=") + std::to_string(levels);
+  uint8_t lut[256];
+  for (int v = 0; v < 256; ++v)
+    lut[v] = (uint8_t)(v / levels * levels);
+  p.native = std::make_shared<ChainStage>(
+      std::vector<std::shared_ptr<NativeStage>>{
+          std::make_shared<LutStage>(lut),
+          std::make_shared<SpatialStage>(gauss_op(0.4), gauss_op(0.4))});
+  p.native_vf = native_scale_vf(ctx);
+  return p;
 }
 
-bool make_ghosting(Context &ctx, std::vector<OutFile> &outs) {
+DefectPlan plan_ghosting(Context &ctx) {
   // 轻度 ghosting：tblend 轻微平均，产生时域残影
-  // 注意：tblend 需要至少两帧才起效
+  // tblend 丢弃首帧（其输出第 i 帧为输入 i+1 与 i 的混合），故首帧单独取出原样
+  // 接在前面：帧数与输入一致，第 i 帧 = 输入 i 与 i-1 的混合，与原生路径逐帧相同
   std::uniform_real_distribution<double> op(0.25, 0.35);
   double opacity = op(ctx.rng);
   std::ostringstream vf;
-  vf << "tblend=all_mode=average:all_opacity=" << std::fixed
-     << std::setprecision(2) << opacity << ",scale=trunc(iw/2)*2:trunc(ih/2)*2";
-  string suf = rand_suffix(ctx);
-  string out = pstr(fs::absolute(ctx.cfg.out_dir / outname(ctx, suf)));
-  auto cmd = base_in_args(ctx);
-  cmd.insert(cmd.end(),
-             {"-vf", vf.str(), "-c:v", "libx264", "-crf", "22", out});
-  if (run_cmd(cmd) != 0) {
-    outs.push_back({fs::path(out).filename().string(), "ghosting", "FAILED"});
-    return false;
-  }
+  vf << "split[gi][gf];[gf]trim=end_frame=1[g0];"
+     << "[gi]tblend=all_mode=average:all_opacity=" << std::fixed
+     << std::setprecision(2) << opacity << "[gb];"
+     << "[g0][gb]concat=n=2:v=1:a=0,scale=trunc(iw/2)*2:trunc(ih/2)*2";
+  DefectPlan p;
+  p.kind = "ghosting";
+  p.vf = vf.str();
+  p.filename = outname(ctx, rand_suffix(ctx));
+  p.enc_args = {"-c:v", "libx264", "-crf", "22"};
+  p.native = std::make_shared<GhostStage>(opacity);
+  p.native_vf = native_scale_vf(ctx);
   std::ostringstream det;
   det << "opacity=" << std::setprecision(2) << opacity;
-  outs.push_back({fs::path(out).filename().string(), "ghosting", det.str()});
-  return true;
+  p.details = det.str();
+  return p;
 }
 
-bool make_colorspace_mismatch(Context &ctx, std::vector<OutFile> &outs) {
+DefectPlan plan_colorspace_mismatch(Context &ctx) {
   // 在解码/过滤阶段假设 BT.709，输出标记/转换为
   // BT.601（或反之），制造色彩空间错配 这里选择统一将输入当作 bt709
   // 解码，然后在编码输出时标记/转换为 bt601，产生轻微色偏 注：不同 ffmpeg
@@ -655,24 +738,23 @@ bool make_colorspace_mismatch(Context &ctx, std::vector<OutFile> &outs) {
      << ":dst=" << (to601 ? "bt601" : "bt709")
      << ",scale=trunc(iw/2)*2:trunc(ih/2)*2";
 
-  string suf = rand_suffix(ctx);
-  string out = pstr(fs::absolute(ctx.cfg.out_dir / outname(ctx, suf)));
-  auto cmd = base_in_args(ctx);
-  cmd.insert(cmd.end(),
-             {"-vf", vf.str(), "-c:v", "libx264", "-crf", "22", out});
-  if (run_cmd(cmd) != 0) {
-    outs.push_back(
-        {fs::path(out).filename().string(), "colorspace_mismatch", "FAILED"});
-    return false;
-  }
+  DefectPlan p;
+  p.kind = "colorspace_mismatch";
+  p.vf = vf.str();
+  p.filename = outname(ctx, rand_suffix(ctx));
+  p.enc_args = {"-c:v", "libx264", "-crf", "22"};
   std::ostringstream det;
   det << inspace << "->" << outspace;
-  outs.push_back(
-      {fs::path(out).filename().string(), "colorspace_mismatch", det.str()});
-  return true;
+  p.details = det.str();
+  // 原生路径：Q14 定点矩阵，结果不随 ffmpeg 构建变化
+  const ColorSpec bt601{ColorMatrix::Bt601, false}, bt709{ColorMatrix::Bt709, false};
+  p.native = std::make_shared<ColorMatrixStage>(ctx.geo, to601 ? bt709 : bt601,
+                                                to601 ? bt601 : bt709);
+  p.native_vf = native_scale_vf(ctx);
+  return p;
 }
 
-bool make_repeat(Context &ctx, std::vector<OutFile> &outs) {
+DefectPlan plan_repeat(Context &ctx) {
   // 纯 ffmpeg 滤镜：在位置 p 将该帧重复 r 次，并丢弃其后的 r 帧，保持总帧数一致
   int N = (int)ctx.total_frames;
   if (N <= 0) {
@@ -688,55 +770,1034 @@ bool make_repeat(Context &ctx, std::vector<OutFile> &outs) {
 
   // 构建滤镜：三段 select + loop；各段重置 PTS，从 0 开始；concat 后用 fps
   // 归一到原 fps
-  std::ostringstream vf;
-  vf << "split=3[v0][v1][v2];"
-     << "[v0]select='lte(n\\," << p << ")',setpts=PTS-STARTPTS[a];"
-     << "[v1]select='eq(n\\," << p << ")',loop=" << r
-     << ":1:0,setpts=PTS-STARTPTS[b];"
-     << "[v2]select='gt(n\\," << drop_end << ")',setpts=PTS-STARTPTS[c];"
-     << "[a][b][c]concat=n=3:v=1:a=0,fps=" << ctx.cfg.fps
-     << ",scale=trunc(iw/2)*2:trunc(ih/2)*2";
+  const string rate = ctx.rate;
+  auto vf_at = [=](int off) {
+    std::ostringstream vf;
+    vf << "split=3[v0][v1][v2];"
+       << "[v0]select='lte(n\\," << p - off << ")',setpts=PTS-STARTPTS[a];"
+       << "[v1]select='eq(n\\," << p - off << ")',loop=" << r
+       << ":1:0,setpts=PTS-STARTPTS[b];"
+       << "[v2]select='gt(n\\," << drop_end - off
+       << ")',setpts=PTS-STARTPTS[c];"
+       << "[a][b][c]concat=n=3:v=1:a=0,fps=" << rate
+       << ",scale=trunc(iw/2)*2:trunc(ih/2)*2";
+    return vf.str();
+  };
+
+  DefectPlan plan;
+  plan.kind = "repeat_frames_keep_count";
+  plan.vf = vf_at(0);
+  plan.filename = outname(ctx, rand_suffix(ctx));
+  plan.pre_args = {"-fflags", "+genpts", "-vsync", "cfr",
+                   "-r",      ctx.rate};
+  plan.enc_args = {"-c:v", "libx264", "-crf", "22"};
 
-  string suf = rand_suffix(ctx);
-  string out = pstr(fs::absolute(ctx.cfg.out_dir / outname(ctx, suf)));
+  std::ostringstream det;
+  det << "repeat_at=" << p << " times=" << r << " drop=[" << (p + 1) << ".."
+      << drop_end << "]";
+  plan.details = det.str();
+  // 输出中 [p+1..drop_end] 被替换为第 p 帧，其余帧号不变
+  // 帧段模式：段内各帧都取自第 p 帧，即帧段起点前 1 帧
+  if (drop_end > p) {
+    plan.spans = {{p + 1, drop_end}};
+    plan.vf_at = vf_at;
+    plan.lookback = 1;
+  }
+  // 原生路径：同样的效果只是一张帧序表，直接按表从映射输入取帧
+  if (ctx.total_frames > 0 && drop_end > p) {
+    plan.frame_map = identity_map(ctx.total_frames);
+    map_freeze(plan.frame_map, (size_t)p + 1, (size_t)(drop_end - p));
+    plan.native_vf = native_scale_vf(ctx);
+  }
+  return plan;
+}
+
+// 子进程选项：stderr 写入 out_dir/logs/<name>.log，并应用 --timeout
+static ProcOptions job_opts(const Context &ctx, const string &name) {
+  ProcOptions opt;
+  fs::path logs = ctx.cfg.out_dir / "logs";
+  if (util_ensure_dir(logs))
+    opt.stderr_log = (logs / (fs::path(name).stem().string() + ".log")).string();
+  opt.timeout_s = ctx.cfg.timeout;
+  return opt;
+}
+
+static void report_failure(const string &kind, int code, const Proc &pr,
+                           const ProcOptions &opt) {
+  std::ostringstream ss;
+  ss << "[fail] " << kind << ": exit=" << code;
+  if (pr.timed_out())
+    ss << " (timeout)";
+  if (!opt.stderr_log.empty())
+    ss << " (see " << pstr(opt.stderr_log) << ")";
+  // 附上 stderr 最后一行非空内容
+  const string &t = pr.err_tail();
+  size_t e = t.find_last_not_of("\r\n");
+  if (e != string::npos) {
+    size_t b = t.find_last_of("\r\n", e);
+    ss << ": " << t.substr(b == string::npos ? 0 : b + 1, e - b);
+  }
+  std::cerr << ss.str() + "\n";
+}
+
+// 单次 ffmpeg 的遥测：-progress pipe:1 解析出已编码帧数与倍速，
+// 汇入全局进度；结束后得到墙钟/CPU 时间（子进程 + 本线程的原生处理）
+namespace {
+struct JobTelemetry {
+  FfProgress fp;
+  JobProgress jp;
+  uint64_t mult; // 每个 progress 帧对应的输出帧数（fan-out 组内的输出数）
+  std::chrono::steady_clock::time_point t0;
+  double cpu0;
+
+  JobTelemetry(uint64_t frames, size_t outputs)
+      : jp(frames * outputs), mult(outputs),
+        t0(std::chrono::steady_clock::now()), cpu0(thread_cpu_s()) {}
+
+  void attach(std::vector<string> &cmd, ProcOptions &opt) {
+    cmd.insert(cmd.begin() + 1, {"-progress", "pipe:1", "-nostats"});
+    opt.on_stdout = [this](const char *p, size_t n) {
+      fp.feed(p, n);
+      jp.update(fp.frame() * mult);
+    };
+  }
+
+  // extra_cpu：线程池中其他线程代为执行的原生处理时间
+  JobStats finish(const Proc &pr, int code, double extra_cpu = 0) const {
+    JobStats st;
+    st.wall_s = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - t0)
+                    .count();
+    st.cpu_s = pr.usage().cpu_s + (thread_cpu_s() - cpu0) + extra_cpu;
+    st.frames = fp.frame();
+    st.fps = st.wall_s > 0 ? st.frames / st.wall_s : 0;
+    st.speed = fp.speed();
+    st.exit_code = code;
+    st.timed_out = pr.timed_out();
+    if (code != 0)
+      st.err_tail = pr.err_tail();
+    return st;
+  }
+};
+} // namespace
 
+static OutFile out_entry(const Context &ctx, const DefectPlan &p,
+                         const string &details, const JobStats &st) {
+  OutFile o{p.filename, p.kind, details};
+  o.stats = st;
+  o.stats.out_bytes = file_size_or(ctx.cfg.out_dir / p.filename);
+  return o;
+}
+
+// 线程参数：-filter_threads 为全局选项，插在程序名之后；-threads 紧跟各输出
+static void add_filter_threads(std::vector<string> &cmd, int threads,
+                               bool complex) {
+  if (threads <= 0)
+    return;
+  cmd.insert(cmd.begin() + 1, {complex ? "-filter_complex_threads"
+                                       : "-filter_threads",
+                               std::to_string(threads)});
+}
+
+static void add_enc_threads(std::vector<string> &cmd, int threads) {
+  if (threads > 0)
+    cmd.insert(cmd.end(), {"-threads", std::to_string(threads)});
+}
+
+// 输出路径；先删除同名旧文件，让 ffmpeg 新建 inode，
+// 避免改写与结果缓存共用 inode 的硬链接
+static string fresh_out_path(const Context &ctx, const DefectPlan &p) {
+  const fs::path out = fs::absolute(ctx.cfg.out_dir / p.filename);
+  std::error_code ec;
+  fs::remove(out, ec);
+  return pstr(out);
+}
+
+bool run_plan(const Context &ctx, const DefectPlan &p,
+              std::vector<OutFile> &outs, int threads) {
   auto cmd = base_in_args(ctx);
-  cmd.insert(cmd.end(), {"-fflags", "+genpts", "-vsync", "cfr", "-r",
-                         std::to_string(ctx.cfg.fps), "-vf", vf.str(), "-c:v",
-                         "libx264", "-crf", "22", out});
-  if (run_cmd(cmd) != 0) {
-    outs.push_back({fs::path(out).filename().string(),
-                    "repeat_frames_keep_count", "FAILED"});
+  add_filter_threads(cmd, threads, false);
+  cmd.insert(cmd.end(), p.pre_args.begin(), p.pre_args.end());
+  cmd.insert(cmd.end(), {"-vf", p.vf});
+  cmd.insert(cmd.end(), p.enc_args.begin(), p.enc_args.end());
+  add_window_out(cmd, ctx);
+  add_enc_threads(cmd, threads);
+  cmd.push_back(fresh_out_path(ctx, p));
+  ProcOptions opt = job_opts(ctx, p.filename);
+  JobTelemetry tm(ctx.total_frames, 1);
+  tm.attach(cmd, opt);
+  log_cmd(join_cmd(cmd));
+  Proc pr;
+  int code = pr.start(cmd, opt) ? pr.wait() : -1;
+  const JobStats st = tm.finish(pr, code);
+  if (code != 0) {
+    report_failure(p.kind, code, pr, opt);
+    outs.push_back(out_entry(ctx, p, "FAILED", st));
     return false;
   }
+  outs.push_back(out_entry(ctx, p, p.details, st));
+  return true;
+}
 
-  std::ostringstream det;
-  det << "repeat_at=" << p << " times=" << r << " drop=[" << (p + 1) << ".."
-      << drop_end << "]";
-  outs.push_back({fs::path(out).filename().string(), "repeat_frames_keep_count",
-                  det.str()});
+static bool native_ok(const Context &ctx, const DefectPlan &p) {
+  return ctx.cfg.native && (p.native || !p.frame_map.empty()) &&
+         ctx.geo.valid();
+}
+
+bool run_native(const Context &ctx, const DefectPlan &p,
+                std::vector<OutFile> &outs, int threads) {
+  FrameSource src;
+  if ((!p.native && p.frame_map.empty()) || !open_source(ctx, src) ||
+      !map_valid(p.frame_map, src.frame_count())) {
+    std::cerr << "[warn] native path unavailable for " << p.kind << "\n";
+    JobProgress done(ctx.total_frames);
+    outs.push_back({p.filename, p.kind, "FAILED"});
+    return false;
+  }
+  // 原始帧经 stdin 送入编码器，输入参数与 rawvideo 布局一致
+  std::vector<string> cmd{ctx.cfg.ffmpeg, "-hide_banner", "-y"};
+  add_filter_threads(cmd, threads, false);
+  cmd.insert(cmd.end(),
+             {"-f", "rawvideo", "-pix_fmt", ctx.cfg.pix, "-s",
+              std::to_string(ctx.cfg.w) + "x" + std::to_string(ctx.cfg.h),
+              "-r", ctx.rate, "-i", "-"});
+  cmd.insert(cmd.end(), p.pre_args.begin(), p.pre_args.end());
+  if (!p.native_vf.empty())
+    cmd.insert(cmd.end(), {"-vf", p.native_vf});
+  cmd.insert(cmd.end(), p.enc_args.begin(), p.enc_args.end());
+  add_enc_threads(cmd, threads);
+  cmd.push_back(fresh_out_path(ctx, p));
+
+  ProcOptions opt = job_opts(ctx, p.filename);
+  opt.pipe_stdin = true;
+  JobTelemetry tm(ctx.total_frames, 1);
+  tm.attach(cmd, opt);
+  log_cmd(join_cmd(cmd));
+  Proc enc;
+  bool ok = enc.start(cmd, opt);
+  // 流水线：读取线程按帧序表取帧（零拷贝视图）并预取页面 → 处理线程各持一份
+  // native 阶段（时域阶段只有一个）→ 本线程按帧序写入编码器。
+  // 宽度同编码线程预算，处理线程内的行条带在共享线程池上并行
+  ParallelScope scope(threads);
+  const bool remap = !p.frame_map.empty();
+  const size_t count = remap ? p.frame_map.size() : src.frame_count();
+  std::vector<std::shared_ptr<NativeStage>> stages;
+  if (p.native) {
+    stages.push_back(p.native);
+    if (!p.native->temporal())
+      for (int k = 1; k < std::min(scope.width(), 8); ++k)
+        stages.push_back(p.native->clone());
+  }
+  PipelineStats ps;
+  if (ok)
+    ok = run_pipeline(
+        count,
+        [&](size_t i) { return src.frame(remap ? p.frame_map[i] : i); },
+        stages, [&](const FrameView &f) { return write_frame(enc, f); },
+        scope, ps);
+  int code = enc.wait();
+  JobStats st = tm.finish(enc, code, scope.cpu_s());
+  st.pipe = ps;
+  if (code != 0)
+    report_failure(p.kind, code, enc, opt);
+  if (!ok || code != 0) {
+    outs.push_back(out_entry(ctx, p, "FAILED", st));
+    return false;
+  }
+  outs.push_back(out_entry(ctx, p, p.details + " (native)", st));
   return true;
 }
 
-bool make_all(Context &ctx, std::vector<OutFile> &outs) {
-  // 顺序可自由调整
+// 将 -vf 链内部的 [label] 加上前缀，避免多个链拼入同一 filter_complex 时重名
+static string prefix_labels(const string &vf, const string &pre) {
+  string r;
+  r.reserve(vf.size() + 32);
+  bool quoted = false;
+  for (size_t i = 0; i < vf.size(); ++i) {
+    char c = vf[i];
+    if (c == '\'')
+      quoted = !quoted;
+    r += c;
+    if (c == '[' && !quoted)
+      r += pre;
+  }
+  return r;
+}
+
+bool run_fanout(const Context &ctx, const std::vector<DefectPlan> &plans,
+                std::vector<OutFile> &outs, int threads) {
+  // 一次解码：[0:v] split -> 各缺陷滤镜链 -> 各自编码输出
+  if (plans.empty())
+    return true;
+  const size_t n = plans.size();
+  std::ostringstream fc;
+  if (n == 1) {
+    fc << "[0:v]" << prefix_labels(plans[0].vf, "p0_") << "[o0]";
+  } else {
+    fc << "[0:v]split=" << n;
+    for (size_t i = 0; i < n; ++i)
+      fc << "[i" << i << "]";
+    for (size_t i = 0; i < n; ++i) {
+      string pre = "p" + std::to_string(i) + "_";
+      fc << ";[i" << i << "]" << prefix_labels(plans[i].vf, pre) << "[o" << i
+         << "]";
+    }
+  }
+
+  auto cmd = base_in_args(ctx);
+  add_filter_threads(cmd, threads, true);
+  cmd.insert(cmd.end(), {"-filter_complex", fc.str()});
+  // 预算由组内各编码器均分
+  const int enc_threads = threads > 0 ? std::max(1, threads / (int)n) : 0;
+  for (size_t i = 0; i < n; ++i) {
+    cmd.insert(cmd.end(), {"-map", "[o" + std::to_string(i) + "]"});
+    cmd.insert(cmd.end(), plans[i].pre_args.begin(), plans[i].pre_args.end());
+    cmd.insert(cmd.end(), plans[i].enc_args.begin(), plans[i].enc_args.end());
+    add_window_out(cmd, ctx);
+    add_enc_threads(cmd, enc_threads);
+    cmd.push_back(fresh_out_path(ctx, plans[i]));
+  }
+  // 单进程无法区分各输出的成败：失败时整组标记 FAILED
+  ProcOptions opt = job_opts(ctx, "fanout_" + plans[0].filename);
+  JobTelemetry tm(ctx.total_frames, n);
+  tm.attach(cmd, opt);
+  log_cmd(join_cmd(cmd));
+  Proc pr;
+  int code = pr.start(cmd, opt) ? pr.wait() : -1;
+  if (code != 0)
+    report_failure("fanout", code, pr, opt);
+  const bool ok = code == 0;
+  // 组内各输出共享同一进程的计时，以 group 标识
+  JobStats st = tm.finish(pr, code);
+  st.group = "fanout_" + fs::path(plans[0].filename).stem().string();
+  for (auto &p : plans)
+    outs.push_back(out_entry(ctx, p, ok ? p.details : "FAILED", st));
+  return ok;
+}
+
+// 帧段模式的适用条件：段已知、帧数已知，且为 libx264（依赖 -forced-idr）
+static bool span_ok(const Context &ctx, const DefectPlan &p) {
+  return ctx.cfg.spans && !p.spans.empty() && ctx.total_frames > 0 &&
+         !native_ok(ctx, p) &&
+         std::find(p.enc_args.begin(), p.enc_args.end(), "libx264") !=
+             p.enc_args.end();
+}
+
+// 段裁剪到 [0, N)
+static std::pair<int, int> clamp_span(std::pair<int, int> s, int N) {
+  const int a = std::clamp(s.first, 0, N - 1);
+  return {a, std::clamp(s.second, a, N - 1)};
+}
+
+// 各段并集的帧数
+static uint64_t span_frames(const DefectPlan &p, int N) {
+  std::vector<std::pair<int, int>> v;
+  for (auto s : p.spans)
+    v.push_back(clamp_span(s, N));
+  std::sort(v.begin(), v.end());
+  uint64_t n = 0;
+  int end = -1; // 已计入的最后一帧
+  for (auto &s : v) {
+    if (s.second <= end)
+      continue;
+    n += (uint64_t)(s.second - std::max(s.first, end + 1) + 1);
+    end = s.second;
+  }
+  return n;
+}
+
+// 段边界：各 span 的起点与终点+1，含 0 与 N；段 j 为 [cuts[j], cuts[j+1])
+static std::vector<int> span_cuts(const std::vector<const DefectPlan *> &ps,
+                                  int N) {
+  std::set<int> cut_set{0, N};
+  for (auto *p : ps)
+    for (auto sp : p->spans) {
+      sp = clamp_span(sp, N);
+      cut_set.insert(sp.first);
+      cut_set.insert(sp.second + 1);
+    }
+  return std::vector<int>(cut_set.begin(), cut_set.end());
+}
+
+bool run_spans(const Context &ctx, const std::vector<DefectPlan> &plans,
+               std::vector<OutFile> &outs, int threads,
+               const std::vector<int> &group_cuts) {
+  if (plans.empty())
+    return true;
+  const int N = (int)ctx.total_frames;
+  const size_t n = plans.size();
+
+  std::vector<const DefectPlan *> ps;
+  for (auto &p : plans)
+    ps.push_back(&p);
+  const std::vector<int> cuts =
+      group_cuts.empty() ? span_cuts(ps, N) : group_cuts;
+  const size_t nseg = cuts.size() - 1;
+
+  const string stem = fs::path(plans[0].filename).stem().string();
+  const fs::path tmp = fs::absolute(ctx.cfg.out_dir / (".spans_" + stem));
+  std::error_code ec;
+  fs::remove_all(tmp, ec);
+  util_ensure_dir(tmp);
+  auto seg_path = [&](const string &pre, size_t j) {
+    string num = std::to_string(j);
+    if (num.size() < 4)
+      num.insert(0, 4 - num.size(), '0');
+    return pstr(tmp / (pre + "_" + num + ".ts"));
+  };
+
+  // 进度：参考流的每帧计入未重编码部分（按输出数折算），段编码按实际帧数
+  uint64_t redo = 0;
+  for (auto &p : plans)
+    redo += span_frames(p, N);
+  const uint64_t expected = (uint64_t)N * n;
+  JobProgress jp(expected);
+  uint64_t done = 0;
+
+  // 单步 ffmpeg：返回退出码，计时累加到 st
+  auto step = [&](std::vector<string> cmd, const string &kind,
+                  const string &log, double scale, JobStats &st) {
+    ProcOptions opt = job_opts(ctx, log);
+    FfProgress fp;
+    cmd.insert(cmd.begin() + 1, {"-progress", "pipe:1", "-nostats"});
+    opt.on_stdout = [&](const char *p, size_t k) {
+      fp.feed(p, k);
+      jp.update(done + (uint64_t)(fp.frame() * scale));
+    };
+    log_cmd(join_cmd(cmd));
+    const auto t0 = std::chrono::steady_clock::now();
+    Proc pr;
+    const int code = pr.start(cmd, opt) ? pr.wait() : -1;
+    st.wall_s += std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - t0)
+                     .count();
+    st.cpu_s += pr.usage().cpu_s;
+    st.frames += fp.frame();
+    done += (uint64_t)(fp.frame() * scale);
+    if (code != 0) {
+      report_failure(kind, code, pr, opt);
+      st.exit_code = code;
+      st.timed_out = pr.timed_out();
+      st.err_tail = pr.err_tail();
+    }
+    return code;
+  };
+
+  // 1) 参考流：与缺陷相同的编码参数（组内各缺陷一致，见 plan_run），
+  //    段边界处强制 IDR，按段切成 mpegts
+  std::ostringstream kf, sf;
+  kf << "expr:";
+  for (size_t j = 1; j < nseg; ++j) {
+    kf << (j > 1 ? "+" : "") << "eq(n\\," << cuts[j] << ")";
+    sf << (j > 1 ? "," : "") << cuts[j];
+  }
+  auto cmd = base_in_args(ctx);
+  add_filter_threads(cmd, threads, false);
+  cmd.insert(cmd.end(), {"-vf", native_scale_vf(ctx).empty()
+                                    ? "null"
+                                    : native_scale_vf(ctx)});
+  cmd.insert(cmd.end(), plans[0].enc_args.begin(), plans[0].enc_args.end());
+  add_window_out(cmd, ctx);
+  if (nseg > 1)
+    cmd.insert(cmd.end(), {"-force_key_frames", kf.str(), "-forced-idr", "1",
+                           "-f", "segment", "-segment_format", "mpegts",
+                           "-segment_frames", sf.str(), "-reset_timestamps",
+                           "1"});
+  else
+    cmd.insert(cmd.end(), {"-f", "mpegts"});
+  add_enc_threads(cmd, threads);
+  cmd.push_back(nseg > 1 ? pstr(tmp / "ref_%04d.ts") : seg_path("ref", 0));
+  JobStats ref;
+  const double ref_scale = N > 0 ? double(expected - redo) / N : 0;
+  const bool ref_ok =
+      step(cmd, "spans_reference", "spans_ref_" + plans[0].filename, ref_scale,
+           ref) == 0;
+
+  bool all_ok = ref_ok;
+  for (size_t i = 0; i < n; ++i) {
+    const DefectPlan &p = plans[i];
+    // 参考流计时由组内各输出均摊
+    JobStats st;
+    st.wall_s = ref.wall_s / n;
+    st.cpu_s = ref.cpu_s / n;
+    st.group = "spans_" + stem;
+    bool ok = ref_ok;
+
+    // 2) 与该缺陷各段相交的参考段逐个重编码。输入从 s 起读（段起点，需回看的
+    //    滤镜再提前到所在帧段起点前 lookback 帧），滤镜链中的帧号相应减去 s；
+    //    输出第 k 帧只依赖输入 <=k 的帧，故先丢弃段后的输入，滤镜之后再截出本段
+    std::vector<string> list(nseg);
+    for (size_t j = 0; j < nseg; ++j)
+      list[j] = seg_path("ref", j);
+    for (size_t j = 0; ok && j < nseg; ++j) {
+      const int a = cuts[j], b = cuts[j + 1] - 1;
+      bool hit = false;
+      int s = a;
+      for (auto sp : p.spans) {
+        sp = clamp_span(sp, N);
+        if (sp.first > b || sp.second < a)
+          continue;
+        hit = true;
+        if (p.lookback > 0)
+          s = std::min(s, std::max(0, sp.first - p.lookback));
+      }
+      if (!hit)
+        continue;
+      if (!p.vf_at)
+        s = 0;
+      std::ostringstream vf;
+      vf << "trim=end_frame=" << (b + 1 - s) << ","
+         << (p.vf_at ? p.vf_at(s) : p.vf) << ",trim=start_frame=" << (a - s)
+         << ":end_frame=" << (b + 1 - s) << ",setpts=PTS-STARTPTS";
+      auto sc = base_in_args(ctx, (size_t)s);
+      add_filter_threads(sc, threads, false);
+      sc.insert(sc.end(), p.pre_args.begin(), p.pre_args.end());
+      sc.insert(sc.end(), {"-vf", vf.str()});
+      sc.insert(sc.end(), p.enc_args.begin(), p.enc_args.end());
+      sc.insert(sc.end(), {"-f", "mpegts"});
+      add_enc_threads(sc, threads);
+      list[j] = seg_path("seg" + std::to_string(i), j);
+      sc.push_back(list[j]);
+      ok = step(sc, p.kind, p.filename + "_seg" + std::to_string(j), 1.0,
+                st) == 0;
+    }
+
+    // 3) 拼接：concat demuxer + stream copy
+    if (ok) {
+      std::ostringstream ls;
+      for (auto &f : list)
+        ls << "file '" << f << "'\n";
+      const fs::path lp = tmp / ("list" + std::to_string(i) + ".txt");
+      ok = util_write_text(lp, ls.str());
+      std::vector<string> cc{ctx.cfg.ffmpeg, "-hide_banner", "-y",  "-f",
+                             "concat",       "-safe",        "0",   "-i",
+                             pstr(lp),       "-c",           "copy"};
+      cc.push_back(fresh_out_path(ctx, p));
+      JobStats cs;
+      ok = ok && step(cc, p.kind, p.filename, 0.0, cs) == 0;
+      st.wall_s += cs.wall_s;
+      st.cpu_s += cs.cpu_s;
+      if (!ok && st.exit_code == 0) {
+        st.exit_code = cs.exit_code ? cs.exit_code : -1;
+        st.err_tail = cs.err_tail;
+      }
+    } else if (!ref_ok) {
+      st.exit_code = ref.exit_code;
+      st.timed_out = ref.timed_out;
+      st.err_tail = ref.err_tail;
+    }
+    st.fps = st.wall_s > 0 ? st.frames / st.wall_s : 0;
+    all_ok &= ok;
+    std::ostringstream det;
+    det << p.details << " (spans: " << span_frames(p, N) << "/" << N
+        << " frames re-encoded)";
+    outs.push_back(out_entry(ctx, p, ok ? det.str() : "FAILED", st));
+  }
+  fs::remove_all(tmp, ec);
+  return all_ok;
+}
+
+bool make_blocky(Context &ctx, std::vector<OutFile> &outs) {
+  return run_plan(ctx, plan_blocky(ctx), outs);
+}
+bool make_brightness(Context &ctx, std::vector<OutFile> &outs) {
+  return run_plan(ctx, plan_brightness(ctx), outs);
+}
+bool make_jitter(Context &ctx, std::vector<OutFile> &outs) {
+  return run_plan(ctx, plan_jitter(ctx), outs);
+}
+bool make_smooth(Context &ctx, std::vector<OutFile> &outs) {
+  return run_plan(ctx, plan_smooth(ctx), outs);
+}
+bool make_highclip(Context &ctx, std::vector<OutFile> &outs) {
+  return run_plan(ctx, plan_highclip(ctx), outs);
+}
+bool make_chroma_bleed(Context &ctx, std::vector<OutFile> &outs) {
+  return run_plan(ctx, plan_chroma_bleed(ctx), outs);
+}
+bool make_luma_bleed(Context &ctx, std::vector<OutFile> &outs) {
+  return run_plan(ctx, plan_luma_bleed(ctx), outs);
+}
+bool make_grain(Context &ctx, std::vector<OutFile> &outs) {
+  return run_plan(ctx, plan_grain(ctx), outs);
+}
+bool make_ringing(Context &ctx, std::vector<OutFile> &outs) {
+  return run_plan(ctx, plan_ringing(ctx), outs);
+}
+bool make_banding(Context &ctx, std::vector<OutFile> &outs) {
+  return run_plan(ctx, plan_banding(ctx), outs);
+}
+bool make_ghosting(Context &ctx, std::vector<OutFile> &outs) {
+  return run_plan(ctx, plan_ghosting(ctx), outs);
+}
+bool make_colorspace_mismatch(Context &ctx, std::vector<OutFile> &outs) {
+  return run_plan(ctx, plan_colorspace_mismatch(ctx), outs);
+}
+bool make_repeat(Context &ctx, std::vector<OutFile> &outs) {
+  return run_plan(ctx, plan_repeat(ctx), outs);
+}
+
+const std::vector<DefectEntry> &defect_table() {
+  // 顺序可自由调整；type 同时参与 RNG 派生，修改会改变该缺陷的随机参数
+  static const std::vector<DefectEntry> table{
+      {"blocky", plan_blocky},       {"brightness", plan_brightness},
+      {"jitter", plan_jitter},       {"smooth", plan_smooth},
+      {"highclip", plan_highclip},   {"chroma", plan_chroma_bleed},
+      {"luma", plan_luma_bleed},     {"grain", plan_grain},
+      {"ringing", plan_ringing},     {"banding", plan_banding},
+      {"ghosting", plan_ghosting},   {"colorspace", plan_colorspace_mismatch},
+      {"repeat", plan_repeat},
+  };
+  return table;
+}
+
+uint64_t derive_seed(uint64_t seed, const std::string &type) {
+  // FNV-1a(type) 与 seed 混合后过一遍 splitmix64
+  uint64_t h = 1469598103934665603ULL;
+  for (unsigned char c : type) {
+    h ^= c;
+    h *= 1099511628211ULL;
+  }
+  uint64_t z = seed ^ h;
+  z += 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// 编码参数的“损伤程度”：码率受限（blocky，编码本身即缺陷）优先，其次 crf 越大越差
+static double enc_severity(const std::vector<string> &a) {
+  for (size_t i = 0; i + 1 < a.size(); ++i) {
+    if (a[i] == "-b:v")
+      return 1e9;
+    if (a[i] == "-crf")
+      return std::strtod(a[i + 1].c_str(), nullptr);
+  }
+  return 0;
+}
+
+DefectPlan combine_plans(const Context &ctx,
+                         const std::vector<DefectPlan> &parts) {
+  Context job = ctx;
+  job.rng.seed(derive_seed(ctx.cfg.seed, "combine"));
+  DefectPlan c;
+  c.kind = "combined";
+  c.filename = outname(job, rand_suffix(job));
+  // ffmpeg 路径：前一链的输出标为 [cI]，作为下一链的输入；各链内部标签加前缀避免重名
+  auto chain = [](const std::vector<string> &vfs) {
+    std::ostringstream vf;
+    for (size_t i = 0; i < vfs.size(); ++i) {
+      const string tag = "c" + std::to_string(i);
+      if (i)
+        vf << ";[c" << (i - 1) << "]";
+      vf << prefix_labels(vfs[i], tag + "_");
+      if (i + 1 < vfs.size())
+        vf << "[" << tag << "]";
+    }
+    return vf.str();
+  };
+  std::vector<string> vfs;
+  for (auto &q : parts)
+    vfs.push_back(q.vf);
+  c.vf = chain(vfs);
+  bool all_spans = true;
+  double worst = -1;
+  for (auto &q : parts) {
+    if (c.pre_args.empty())
+      c.pre_args = q.pre_args;
+    const double sev = enc_severity(q.enc_args);
+    if (sev > worst) {
+      worst = sev;
+      c.enc_args = q.enc_args;
+    }
+    all_spans &= !q.spans.empty();
+    c.parts.push_back({q.kind, q.details, q.spans});
+    c.details += (c.details.empty() ? "" : "+") + q.kind;
+  }
+  // 所有组成都是帧段局部时，组合结果也只改动这些帧段；
+  // 各组成都能跳读时，组合链同样可跳读，预读取各组成的最大值
+  if (all_spans) {
+    bool seekable = true;
+    for (auto &q : parts) {
+      c.spans.insert(c.spans.end(), q.spans.begin(), q.spans.end());
+      c.lookback = std::max(c.lookback, q.lookback);
+      seekable &= (bool)q.vf_at;
+    }
+    if (seekable) {
+      std::vector<std::function<string(int)>> ats;
+      for (auto &q : parts)
+        ats.push_back(q.vf_at);
+      c.vf_at = [chain, ats](int off) {
+        std::vector<string> v;
+        for (auto &f : ats)
+          v.push_back(f(off));
+        return chain(v);
+      };
+    }
+  }
+
+  // 原生路径：各组成都有原生实现；除最后一个外，native_vf 只能是尺寸修正。
+  // 帧序表在读入时生效（先于各阶段），只有其组成位于链首时才与 ffmpeg 链等价；
+  // 否则 ffmpeg 冻结的是已处理的帧，而按输出帧号取参数的阶段（grain/jitter/
+  // ghosting）会把冻结帧重新处理一遍，此时回退到 ffmpeg 滤镜图
+  bool native = true;
+  std::vector<std::shared_ptr<NativeStage>> stages;
+  for (size_t i = 0; i < parts.size() && native; ++i) {
+    const DefectPlan &q = parts[i];
+    native = (q.native || !q.frame_map.empty()) &&
+             (i + 1 == parts.size() || q.native_vf == native_scale_vf(ctx)) &&
+             (q.frame_map.empty() || i == 0);
+    if (q.native)
+      stages.push_back(q.native);
+    if (!q.frame_map.empty())
+      c.frame_map = q.frame_map;
+  }
+  if (native) {
+    if (stages.size() == 1)
+      c.native = stages[0];
+    else if (!stages.empty())
+      c.native = std::make_shared<ChainStage>(std::move(stages));
+    c.native_vf = parts.back().native_vf;
+  } else {
+    c.frame_map.clear();
+  }
+  return c;
+}
+
+void plan_run(DefectRun &r, const Context &ctx,
+              const std::vector<DefectEntry> &sel, size_t groups) {
+  r.ctx = ctx;
+  r.plans.clear();
+  r.tasks.clear();
+  // 每个缺陷拥有独立的 Context 副本与 RNG 流，互不干扰；规划本身很轻，串行完成
+  r.plans.reserve(sel.size());
+  for (auto &e : sel) {
+    Context job = ctx;
+    job.rng.seed(derive_seed(ctx.cfg.seed, e.type));
+    r.plans.push_back(e.plan(job));
+  }
+  // 组合模式：各组成参数与单独运行时相同，串成一个输出
+  if (ctx.cfg.combine && r.plans.size() > 1)
+    r.plans = {combine_plans(ctx, r.plans)};
+
+  // 帧段模式的分组（编码参数相同者共用一条参考流）与各组的段边界。
+  // 段边界决定切分与强制 IDR 的位置，因而决定输出的字节：它进入缓存键，
+  // 且组内部分成员命中缓存时，其余成员仍按整组的段边界生成
+  std::map<std::vector<string>, std::vector<const DefectPlan *>> span_groups;
+  for (auto &p : r.plans)
+    if (span_ok(ctx, p))
+      span_groups[p.enc_args].push_back(&p);
+  r.cuts.assign(r.plans.size(), {});
+  for (auto &kv : span_groups) {
+    const std::vector<int> c = span_cuts(kv.second, (int)ctx.total_frames);
+    for (auto *p : kv.second)
+      r.cuts[(size_t)(p - r.plans.data())] = c;
+  }
+
+  r.per.assign(r.plans.size(), {});
+  r.keys.assign(ctx.cache ? r.plans.size() : 0, string());
+  std::vector<char> hit(r.plans.size(), 0);
+  for (size_t i = 0; i < r.keys.size(); ++i) {
+    const DefectPlan &p = r.plans[i];
+    r.keys[i] = cache_key(ctx, p, r.cuts[i]);
+    CacheEntry e;
+    if (!ctx.cache->fetch(r.keys[i], ctx.cfg.out_dir / p.filename, e))
+      continue;
+    OutFile o{p.filename, p.kind, e.details};
+    o.stats.frames = e.frames;
+    o.stats.wall_s = e.wall_s;
+    o.stats.cpu_s = e.cpu_s;
+    o.stats.fps = e.fps;
+    o.stats.speed = e.speed;
+    o.stats.out_bytes = file_size_or(ctx.cfg.out_dir / p.filename);
+    o.stats.cached = true;
+    r.per[i].push_back(o);
+    hit[i] = 1;
+  }
+
+  // 任务划分：原生路径各自一个任务；其余分成 groups 个 fan-out 组
+  // （每组一次 ffmpeg，一次读入/解码），或每个缺陷一次 ffmpeg
+  // 帧段模式下，编码参数相同的帧段局部缺陷合成一个任务，共用一条参考流
+  // （拼接靠 stream copy，参考段与重编码段必须出自同一组编码参数）
+  std::vector<size_t> rest;
+  std::map<std::vector<string>, DefectRun::Task> spans;
+  for (size_t i = 0; i < r.plans.size(); ++i) {
+    if (hit[i])
+      continue;
+    if (native_ok(ctx, r.plans[i]))
+      r.tasks.push_back({{i}, false});
+    else if (span_ok(ctx, r.plans[i])) {
+      auto &t = spans[r.plans[i].enc_args];
+      t.span = true;
+      t.idx.push_back(i);
+    } else
+      rest.push_back(i);
+  }
+  for (auto &kv : spans)
+    r.tasks.push_back(kv.second);
+  if (ctx.cfg.fanout && !rest.empty()) {
+    const size_t g = std::min(rest.size(), std::max<size_t>(1, groups));
+    const size_t base = r.tasks.size();
+    r.tasks.resize(base + g, DefectRun::Task{{}, true});
+    for (size_t k = 0; k < rest.size(); ++k)
+      r.tasks[base + k % g].idx.push_back(rest[k]);
+  } else {
+    for (size_t i : rest)
+      r.tasks.push_back({{i}, false});
+  }
+  r.oks.assign(r.tasks.size(), 0);
+}
+
+// 成功的输出存入结果缓存
+static void cache_outputs(const DefectRun &r, const DefectRun::Task &tk) {
+  if (!r.ctx.cache)
+    return;
+  for (size_t i : tk.idx) {
+    if (r.per[i].empty() || r.per[i][0].details == "FAILED")
+      continue;
+    const OutFile &o = r.per[i][0];
+    CacheEntry e;
+    e.kind = o.kind;
+    e.details = o.details;
+    e.frames = o.stats.frames;
+    e.wall_s = o.stats.wall_s;
+    e.cpu_s = o.stats.cpu_s;
+    e.fps = o.stats.fps;
+    e.speed = o.stats.speed;
+    r.ctx.cache->store(r.keys[i], r.ctx.cfg.out_dir / o.filename, e);
+  }
+}
+
+void exec_task(DefectRun &r, size_t t, int threads) {
+  const DefectRun::Task &tk = r.tasks[t];
+  if (tk.fan || tk.span) {
+    std::vector<DefectPlan> ps;
+    for (size_t i : tk.idx)
+      ps.push_back(r.plans[i]);
+    std::vector<OutFile> o;
+    r.oks[t] = (tk.span ? run_spans(r.ctx, ps, o, threads, r.cuts[tk.idx[0]])
+                        : run_fanout(r.ctx, ps, o, threads))
+                   ? 1
+                   : 0;
+    for (size_t k = 0; k < tk.idx.size(); ++k)
+      r.per[tk.idx[k]].push_back(o[k]);
+  } else {
+    const DefectPlan &p = r.plans[tk.idx[0]];
+    std::vector<OutFile> &o = r.per[tk.idx[0]];
+    r.oks[t] = (native_ok(r.ctx, p) ? run_native(r.ctx, p, o, threads)
+                                    : run_plan(r.ctx, p, o, threads))
+                   ? 1
+                   : 0;
+  }
+  cache_outputs(r, tk);
+}
+
+size_t pending_outputs(const DefectRun &r) {
+  size_t n = 0;
+  for (auto &t : r.tasks)
+    n += t.idx.size();
+  return n;
+}
+
+string cache_key(const Context &ctx, const DefectPlan &p,
+                 const std::vector<int> &cuts) {
+  std::ostringstream ss;
+  ss << "yc-cache-1\n"
+     << ctx.input_fp << "\n"
+     << ctx.cfg.pix << " " << ctx.cfg.w << "x" << ctx.cfg.h << " "
+     << ctx.rate << "\n"
+     << "window " << ctx.cfg.start << " " << (windowed(ctx) ? ctx.total_frames : 0)
+     << "\n"
+     << p.kind << "\n";
+  if (native_ok(ctx, p)) {
+    ss << "native " << (p.native ? p.native->signature() : string()) << " "
+       << (p.frame_map.empty() ? string() : map_signature(p.frame_map))
+       << "\n"
+       << p.native_vf << "\n";
+  } else {
+    ss << p.vf << "\n";
+    if (span_ok(ctx, p)) {
+      ss << "spans";
+      for (int c : cuts)
+        ss << " " << c;
+      ss << "\n";
+    }
+  }
+  for (auto &a : p.pre_args)
+    ss << a << "\x1f";
+  ss << "\n";
+  for (auto &a : p.enc_args)
+    ss << a << "\x1f";
+  ss << "\n" << ffmpeg_version(ctx.cfg.ffmpeg) << "\n";
+  const string k = ss.str();
+  return hex64(hash64(k, 1)) + hex64(hash64(k, 2));
+}
+
+// 相对开销：每帧像素 × 帧数 × 缺陷权重（整帧 BMP 往返/多路 split 的更重，
+// 原生路径只剩编码）。有效线程数按分辨率估计，fan-out 组内各编码器叠加
+static double kind_weight(const DefectPlan &p, bool native) {
+  if (native)
+    return 0.7;
+  if (p.kind == "bitrate_blocky")
+    return 0.6; // veryfast 预设
+  if (p.kind == "repeat_frames_keep_count")
+    return 1.5; // split + concat
+  return 1.0;
+}
+
+TaskCost task_cost(const DefectRun &r, size_t t) {
+  const DefectRun::Task &tk = r.tasks[t];
+  const Context &ctx = r.ctx;
+  const double px = (double)std::max(ctx.cfg.w, 1) * std::max(ctx.cfg.h, 1);
+  const double frames = (double)std::max<size_t>(ctx.total_frames, 1);
+  TaskCost c;
+  c.work = 0;
+  if (tk.span) {
+    // 一次参考编码 + 各缺陷的段编码，依次运行
+    c.work = px * frames;
+    for (size_t i : tk.idx)
+      c.work += px * (double)span_frames(r.plans[i], (int)ctx.total_frames) *
+                kind_weight(r.plans[i], false);
+    c.threads = useful_threads(ctx.cfg.w, ctx.cfg.h);
+    return c;
+  }
+  for (size_t i : tk.idx)
+    c.work += px * frames *
+              kind_weight(r.plans[i], !tk.fan && native_ok(ctx, r.plans[i]));
+  c.threads = useful_threads(ctx.cfg.w, ctx.cfg.h) * (int)tk.idx.size();
+  return c;
+}
+
+SchedOptions sched_options(const Settings &s) {
+  SchedOptions o;
+  o.budget = s.threads;
+  o.max_jobs = s.jobs;
+  o.affinity = s.affinity;
+  return o;
+}
+
+bool collect_run(const DefectRun &r, std::vector<OutFile> &outs) {
+  // 按表顺序输出；组合输出附上各组成缺陷
+  for (size_t i = 0; i < r.per.size(); ++i)
+    for (OutFile o : r.per[i]) {
+      o.parts = r.plans[i].parts;
+      outs.push_back(std::move(o));
+    }
   bool ok = true;
-  ok &= make_blocky(ctx, outs);
-  ok &= make_brightness(ctx, outs);
-  ok &= make_jitter(ctx, outs);
-  ok &= make_smooth(ctx, outs);
-  ok &= make_highclip(ctx, outs);
-  ok &= make_chroma_bleed(ctx, outs);
-  ok &= make_luma_bleed(ctx, outs);
-  ok &= make_grain(ctx, outs);
-  ok &= make_ringing(ctx, outs);
-  ok &= make_banding(ctx, outs);
-  ok &= make_ghosting(ctx, outs);
-  ok &= make_colorspace_mismatch(ctx, outs);
-  ok &= make_repeat(ctx, outs);
+  for (char c : r.oks)
+    ok &= c != 0;
   return ok;
 }
 
+bool run_defects(const Context &ctx, const std::vector<DefectEntry> &sel,
+                 std::vector<OutFile> &outs) {
+  // fan-out 分组：固定并发时每个并发一组；自动时按预算能同时容纳的编码数
+  const SchedOptions so = sched_options(ctx.cfg);
+  const int budget = so.budget > 0 ? so.budget : available_cpus();
+  const int groups =
+      so.max_jobs > 0
+          ? so.max_jobs
+          : std::max(1, budget / useful_threads(ctx.cfg.w, ctx.cfg.h));
+  DefectRun r;
+  plan_run(r, ctx, sel, (size_t)groups);
+  progress_add(r.tasks.size(), ctx.total_frames * pending_outputs(r));
+  std::vector<TaskCost> costs;
+  for (size_t t = 0; t < r.tasks.size(); ++t)
+    costs.push_back(task_cost(r, t));
+  run_scheduled(costs, so, [&](size_t t, const CpuSlot &slot) {
+    exec_task(r, t, slot.threads);
+  });
+  if (ctx.cache)
+    ctx.cache->trim();
+  return collect_run(r, outs);
+}
+
+bool make_all(Context &ctx, std::vector<OutFile> &outs) {
+  return run_defects(ctx, defect_table(), outs);
+}
+
+// manifest.json：每个输出一项，含计时/吞吐/大小与失败原因，便于按分辨率与缺陷汇总
+static bool write_manifest_json(const Context &ctx,
+                                const std::vector<OutFile> &outs,
+                                const InputHashes *ih) {
+  std::ostringstream js;
+  js << std::fixed << std::setprecision(3);
+  js << "{\n  \"seed\": " << ctx.cfg.seed
+     << ",\n  \"input\": " << json_quote(ctx.cfg.in_path)
+     << ",\n  \"width\": " << ctx.cfg.w << ",\n  \"height\": " << ctx.cfg.h
+     << ",\n  \"pix\": " << json_quote(ctx.cfg.pix)
+     << ",\n  \"rate\": " << json_quote(ctx.rate)
+     << ",\n  \"total_frames\": " << ctx.total_frames;
+  if (windowed(ctx))
+    js << ",\n  \"window_start\": " << ctx.cfg.start;
+  if (ih && ih->ok)
+    js << ",\n  \"" << (ih->windowed ? "window_hash" : "input_hash")
+       << "\": " << json_quote(hex64(ih->file));
+  js << ",\n  \"outputs\": [";
+  for (size_t i = 0; i < outs.size(); ++i) {
+    const OutFile &o = outs[i];
+    const JobStats &st = o.stats;
+    js << (i ? "," : "") << "\n    {\"file\": " << json_quote(o.filename)
+       << ", \"kind\": " << json_quote(o.kind)
+       << ", \"details\": " << json_quote(o.details)
+       << ", \"ok\": " << (o.details == "FAILED" ? "false" : "true")
+       << ", \"wall_s\": " << st.wall_s << ", \"cpu_s\": " << st.cpu_s
+       << ", \"frames\": " << st.frames << ", \"fps\": " << st.fps
+       << ", \"speed\": " << st.speed << ", \"out_bytes\": " << st.out_bytes
+       << ", \"exit_code\": " << st.exit_code
+       << ", \"timed_out\": " << (st.timed_out ? "true" : "false")
+       << ", \"cached\": " << (st.cached ? "true" : "false");
+    if (!st.group.empty())
+      js << ", \"group\": " << json_quote(st.group);
+    if (!st.pipe.empty()) {
+      const PipelineStats &ps = st.pipe;
+      js << ", \"pipeline\": {\"bound\": " << json_quote(ps.bound)
+         << ", \"workers\": " << ps.workers
+         << ", \"read_busy_s\": " << ps.read_busy_s
+         << ", \"work_busy_s\": " << ps.work_busy_s
+         << ", \"write_busy_s\": " << ps.write_busy_s << ", \"queues\": [";
+      for (size_t k = 0; k < ps.queues.size(); ++k) {
+        const QueueStats &q = ps.queues[k];
+        js << (k ? ", " : "") << "{\"name\": " << json_quote(q.name)
+           << ", \"capacity\": " << q.capacity
+           << ", \"mean_depth\": " << q.mean_depth
+           << ", \"max_depth\": " << q.max_depth
+           << ", \"push_stall_s\": " << q.push_stall_s
+           << ", \"pop_stall_s\": " << q.pop_stall_s << "}";
+      }
+      js << "]}";
+    }
+    if (!o.parts.empty()) {
+      js << ", \"components\": [";
+      for (size_t k = 0; k < o.parts.size(); ++k) {
+        const DefectPart &pt = o.parts[k];
+        js << (k ? ", " : "") << "{\"kind\": " << json_quote(pt.kind)
+           << ", \"details\": " << json_quote(pt.details) << ", \"spans\": [";
+        for (size_t j = 0; j < pt.spans.size(); ++j)
+          js << (j ? ", " : "") << "[" << pt.spans[j].first << ", "
+             << pt.spans[j].second << "]";
+        js << "]}";
+      }
+      js << "]";
+    }
+    if (!st.err_tail.empty())
+      js << ", \"stderr_tail\": " << json_quote(st.err_tail);
+    js << "}";
+  }
+  js << "\n  ]";
+  // 逐帧哈希（hash64 覆盖每帧像素数据），按帧序号
+  if (ih && ih->ok && ih->frame_bytes) {
+    js << ",\n  \"frame_bytes\": " << ih->frame_bytes
+       << ",\n  \"frame_hashes\": [";
+    for (size_t i = 0; i < ih->frames.size(); ++i)
+      js << (i ? (i % 8 ? ", " : ",\n    ") : "\n    ") << '"'
+         << hex64(ih->frames[i]) << '"';
+    js << "\n  ]";
+  }
+  js << "\n}\n";
+  return util_write_text(ctx.cfg.out_dir / "manifest.json", js.str());
+}
+
 bool write_manifest(const Context &ctx, const std::vector<OutFile> &outs) {
   fs::path man = ctx.cfg.out_dir / "manifest.txt";
   std::ostringstream ss;
@@ -744,10 +1805,46 @@ bool write_manifest(const Context &ctx, const std::vector<OutFile> &outs) {
   ss << "input=" << ctx.cfg.in_path << "\n";
   ss << "size=" << ctx.cfg.w << "x" << ctx.cfg.h << " pix=" << ctx.cfg.pix
      << " fps=" << ctx.cfg.fps << "\n";
+  if (ctx.y4m) {
+    ss << "y4m: rate=" << ctx.rate << " interlace=" << ctx.y4m->interlace
+       << " colorspace="
+       << (ctx.y4m->colorspace.empty() ? "-" : ctx.y4m->colorspace) << "\n";
+  }
   ss << "total_frames~=" << ctx.total_frames << " (assume yuv420p 8-bit)\n";
+  if (windowed(ctx))
+    ss << "window: start=" << ctx.cfg.start << " frames=" << ctx.total_frames
+       << " (frame numbers below are relative to start)\n";
+  const InputHashes *ih = ctx.hashes ? &ctx.hashes->wait() : nullptr;
+  if (ih && ih->ok) {
+    ss << (ih->windowed ? "window_hash=" : "input_hash=") << hex64(ih->file)
+       << " frame_hashes="
+       << ih->frames.size() << " (manifest.json)\n";
+    if (ctx.cfg.hash_sidecar &&
+        !write_input_hashes(ctx.cfg.out_dir / "input_hashes.bin", *ih))
+      std::cerr << "failed to write input_hashes.bin\n";
+  } else if (ih) {
+    std::cerr << "[warn] input hashing failed for " << ctx.cfg.in_path << "\n";
+  }
+  // 仅当某个缺陷用到整段统计时输出
+  if (ctx.stats && ctx.stats->value) {
+    const ClipStats &cs = *ctx.stats->value;
+    ss << "stats: sampled=" << cs.per_frame.size() << " step=" << cs.step;
+    static const char *names[3] = {"Y", "U", "V"};
+    for (int k = 0; k < cs.total.planes; ++k) {
+      const PlaneStats &p = cs.total.p[k];
+      ss << " " << names[k] << "[min=" << p.min << " max=" << p.max
+         << " mean=" << std::fixed << std::setprecision(1) << p.mean << "]";
+    }
+    ss << "\n";
+  }
   ss << "outputs:\n";
   for (auto &o : outs) {
-    ss << "  - " << o.filename << " | " << o.kind << " | " << o.details << "\n";
+    ss << "  - " << o.filename << " | " << o.kind << " | " << o.details
+       << (o.stats.cached ? " (cached)" : "") << "\n";
+    for (auto &pt : o.parts)
+      ss << "      + " << pt.kind << " | " << pt.details << "\n";
+    if (!o.stats.pipe.empty())
+      ss << "      pipeline: " << pipeline_summary(o.stats.pipe) << "\n";
   }
   // 统计失败项
   size_t failed = 0;
@@ -756,5 +1853,5 @@ bool write_manifest(const Context &ctx, const std::vector<OutFile> &outs) {
       ++failed;
   if (failed > 0)
     ss << "failed_count=" << failed << "\n";
-  return util_write_text(man, ss.str());
+  return util_write_text(man, ss.str()) && write_manifest_json(ctx, outs, ih);
 }
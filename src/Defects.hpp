@@ -1,11 +1,22 @@
 #pragma once
+#include <functional>
 #include <string>
 #include <random>
 #include <vector>
 #include <filesystem>
 #include <optional>
+#include <memory>
+#include <mutex>
+#include "Cache.hpp"
 #include "Fs.hpp"
+#include "Hash.hpp"
+#include "Pipeline.hpp"
+#include "FrameSource.hpp"
 #include "Process.hpp"
+#include "Remap.hpp"
+#include "Sched.hpp"
+#include "Stats.hpp"
+#include "Y4m.hpp"
 
 struct Settings {
     std::string in_path;
@@ -17,26 +28,187 @@ struct Settings {
     std::filesystem::path out_dir;
     std::string ffmpeg="ffmpeg";
     std::string ffprobe="ffprobe";
+    int jobs=1; // 并行任务数，0=按核预算与任务开销自动决定
+    int threads=0; // 核预算（所有 ffmpeg 线程合计），0=可用 CPU 数
+    bool affinity=false; // 各任务绑定到互不重叠的 CPU
+    bool fanout=false; // 单次解码，一个 ffmpeg 同时写出多个缺陷
+    bool native=false; // 支持的缺陷改走进程内处理，原始帧经 stdin 喂给编码器
+    double timeout=0;  // 单个 ffmpeg 的超时（秒），0=不限
+    size_t stats_step=0; // 统计采样间隔（帧），0=自动
+    std::filesystem::path cache_dir;   // 非空：启用结果缓存
+    uint64_t cache_max=20ull<<30;      // 缓存上限（字节），0=不限
+    bool fingerprint=true;             // 后台计算输入的整文件/逐帧哈希，写入 manifest
+    bool hash_sidecar=false;           // 另写二进制 input_hashes.bin
+    size_t start=0;  // 帧窗口起点；窗口内帧号、缺陷参数与段位置都相对起点
+    size_t frames=0; // 帧窗口长度，0=到结尾
+    bool spans=false;                  // 帧段局部的缺陷只重编码受影响的 GOP，其余从参考流拷贝
+    bool combine=false;                // 所选缺陷串成一条处理链，只输出一个文件（一次解码、一次编码）
+};
+
+// 单个输出的计时与结果；fan-out 组内的输出共享同一个 ffmpeg 的计时
+struct JobStats {
+    double wall_s=0, cpu_s=0; // cpu：ffmpeg 子进程 + 本进程内的原生处理
+    uint64_t frames=0;        // 编码器报告的帧数（-progress）
+    double fps=0;             // frames / wall_s
+    double speed=0;           // ffmpeg 报告的相对实时倍速
+    uint64_t out_bytes=0;
+    int exit_code=0;
+    bool timed_out=false;
+    std::string err_tail;     // 失败时的 stderr 末尾
+    std::string group;        // fan-out 组名，独立任务为空
+    bool cached=false;        // 取自结果缓存（计时为当初生成时的值）
+    PipelineStats pipe;       // 原生路径的流水线统计，其余为空
+};
+
+// 组合输出（--combine）中的一个组成缺陷
+struct DefectPart {
+    std::string kind;
+    std::string details;
+    std::vector<std::pair<int,int>> spans; // 空表示整段
 };
 
 struct OutFile {
     std::string filename;
     std::string kind;
     std::string details; // 参数与位置
+    JobStats stats;
+    std::vector<DefectPart> parts; // 仅组合输出：按处理顺序
+
+    OutFile() = default;
+    OutFile(std::string f, std::string k, std::string d)
+        : filename(std::move(f)), kind(std::move(k)), details(std::move(d)) {}
+};
+
+class NativeStage;
+
+// 单个缺陷的 ffmpeg 描述：滤镜链 + 输出参数 + manifest 详情
+struct DefectPlan {
+    std::string kind;
+    std::string filename;              // 输出文件名（位于 out_dir）
+    std::string vf;                    // -vf 滤镜链，亦可拼入 -filter_complex
+    std::vector<std::string> pre_args; // 位于 -vf 之前的输出参数
+    std::vector<std::string> enc_args; // 编码参数
+    std::string details;
+    // 可选的原生路径：native 处理后的帧再经 native_vf（可空）送入编码器
+    std::shared_ptr<NativeStage> native;
+    std::string native_vf;
+    // 原生路径的帧序：输出第 i 帧取自输入 frame_map[i]（可无 native 阶段）；空=原序
+    FrameMap frame_map;
+    // 仅改动这些帧段（输出帧号，闭区间）；空表示整段都受影响
+    std::vector<std::pair<int,int>> spans;
+    // 帧段模式从输入第 off 帧起读时的滤镜链（链中帧号减去 off）；空则不跳读
+    std::function<std::string(int off)> vf_at;
+    int lookback=0; // 段内帧依赖所在帧段起点前这么多帧的输入；0=逐帧独立
+    std::vector<DefectPart> parts; // 由 combine_plans 合成时的各组成缺陷
+};
+
+// 整段统计：首次使用时计算一次，Context 副本之间共享
+struct StatsCache {
+    std::once_flag once;
+    std::unique_ptr<ClipStats> value;
 };
 
 struct Context {
     Settings cfg;
     std::mt19937_64 rng;
     std::string base;      // 输入无扩展名
-    size_t total_frames=0; // 仅 yuv420p 8-bit
+    size_t total_frames=0; // raw 按 geo.frame_bytes 估算；有帧窗口时为窗口帧数
+    FrameGeometry geo;     // 由 w/h/pix 推出的平面布局
+    std::shared_ptr<StatsCache> stats;
+    std::shared_ptr<const Y4mInfo> y4m; // 仅 .y4m 输入
+    std::string rate;                   // 帧率（ffmpeg -r 语法，如 30000/1001）
+    std::shared_ptr<ResultCache> cache; // 仅 cfg.cache_dir 非空时
+    std::string input_fp;               // 输入指纹（缓存键的一部分）
+    std::shared_ptr<HashJob> hashes;    // 仅 cfg.fingerprint 时；写 manifest 前等待
 };
 
 bool init_context(Context& ctx);
 std::string rand_suffix(Context& ctx);
 bool make_all(Context& ctx, std::vector<OutFile>& outs);
+// 整段 Y/U/V 统计（并行计算，旁路缓存为 <input>.ycstats）；不可用时返回 nullptr
+const ClipStats* clip_stats(const Context& ctx);
+
+// 缺陷类型表：-t 名称 -> 规划函数（顺序即 manifest 中的输出顺序）
+using PlanFn = DefectPlan (*)(Context&);
+struct DefectEntry {
+    const char* type;
+    PlanFn plan;
+};
+const std::vector<DefectEntry>& defect_table();
+// 由 (seed, 缺陷类型) 派生独立的 RNG 种子，与选择顺序/并行度无关
+uint64_t derive_seed(uint64_t seed, const std::string& type);
+// 把多个缺陷按顺序串成一个计划：ffmpeg 路径为各滤镜链首尾相接的单个滤镜图；
+// 各组成都有原生路径时为 ChainStage（帧序表只允许来自链首的组成）；编码参数取质量最低的一个
+DefectPlan combine_plans(const Context& ctx, const std::vector<DefectPlan>& parts);
+// 按 ctx.cfg.jobs 并行运行所选缺陷（cfg.fanout 时合并为单次解码）；outs 按表顺序追加
+bool run_defects(const Context& ctx, const std::vector<DefectEntry>& sel,
+                 std::vector<OutFile>& outs);
+
+// 一个输入的全部 ffmpeg 任务。plan_run 规划并分组，exec_task 可由任意线程调用
+// （不同输入的任务可混在同一个队列里），全部完成后 collect_run 汇总
+struct DefectRun {
+    struct Task {
+        std::vector<size_t> idx; // plans 下标
+        bool fan=false;          // 多个缺陷共用一次 ffmpeg
+        bool span=false;         // 共用一条参考流，只重编码各自的帧段（run_spans）
+    };
+    Context ctx;
+    std::vector<DefectPlan> plans;
+    std::vector<Task> tasks;
+    std::vector<std::vector<OutFile>> per; // 按 plans 顺序
+    std::vector<char> oks;                 // 按 tasks 顺序
+    std::vector<std::string> keys;         // 缓存键（按 plans 顺序，未启用缓存时为空）
+    std::vector<std::vector<int>> cuts;    // 帧段模式所在组（含缓存命中的成员）的段边界，按 plans 顺序
+};
+// groups：cfg.fanout 时非原生缺陷分成的组数；缓存命中的缺陷不再生成任务
+void plan_run(DefectRun& r, const Context& ctx, const std::vector<DefectEntry>& sel,
+              size_t groups);
+void exec_task(DefectRun& r, size_t t, int threads=0);
+// 任务开销估计（供 run_scheduled 排序与分配线程）
+TaskCost task_cost(const DefectRun& r, size_t t);
+// 由 Settings 得到调度参数
+SchedOptions sched_options(const Settings& s);
+bool collect_run(const DefectRun& r, std::vector<OutFile>& outs);
+// 需要实际生成的输出数（不含缓存命中）
+size_t pending_outputs(const DefectRun& r);
+// 缓存键：输入指纹 + 像素格式/尺寸/帧率 + 缺陷 + 滤镜与编码参数 + 原生阶段 + ffmpeg 版本
+// （不含 -threads 等调度参数）；帧段模式的输出另含其所在组的段边界 cuts
+std::string cache_key(const Context& ctx, const DefectPlan& p,
+                      const std::vector<int>& cuts={});
+// 以下 threads>0 时为 ffmpeg 加 -threads/-filter_threads，0=ffmpeg 默认
+// 单个缺陷独立调用 ffmpeg
+bool run_plan(const Context& ctx, const DefectPlan& p, std::vector<OutFile>& outs,
+              int threads=0);
+// 原生路径：映射读取 -> NativeStage -> 编码器 stdin
+bool run_native(const Context& ctx, const DefectPlan& p, std::vector<OutFile>& outs,
+                int threads=0);
+// 多个缺陷共用一次输入读取/解码：split -> 各滤镜链 -> 各自编码
+bool run_fanout(const Context& ctx, const std::vector<DefectPlan>& plans,
+                std::vector<OutFile>& outs, int threads=0);
+
+// 帧段模式：先编码一条在所有段边界强制 IDR 的参考流（按段切成 .ts），
+// 每个缺陷只重编码与其 spans 相交的段，再与参考段按 stream copy 拼接；
+// plans 的 enc_args 须一致。重编码的段只从段起点（或 lookback 预读处）读入。
+// cuts 为段边界（含 0 与总帧数），空则由 plans 的 spans 得出
+bool run_spans(const Context& ctx, const std::vector<DefectPlan>& plans,
+               std::vector<OutFile>& outs, int threads=0,
+               const std::vector<int>& cuts={});
+
+// 各缺陷：plan_* 只抽取随机参数并生成滤镜，make_* = plan_* + run_plan
+DefectPlan plan_blocky(Context&);
+DefectPlan plan_brightness(Context&);
+DefectPlan plan_jitter(Context&);
+DefectPlan plan_smooth(Context&);
+DefectPlan plan_highclip(Context&);
+DefectPlan plan_chroma_bleed(Context&);
+DefectPlan plan_repeat(Context&);
+DefectPlan plan_luma_bleed(Context&);
+DefectPlan plan_grain(Context&);
+DefectPlan plan_ringing(Context&);
+DefectPlan plan_banding(Context&);
+DefectPlan plan_ghosting(Context&);
+DefectPlan plan_colorspace_mismatch(Context&);
 
-// 各缺陷
 bool make_blocky(Context&, std::vector<OutFile>&);
 bool make_brightness(Context&, std::vector<OutFile>&);
 bool make_jitter(Context&, std::vector<OutFile>&);
@@ -51,5 +223,5 @@ bool make_banding(Context&, std::vector<OutFile>&);
 bool make_ghosting(Context&, std::vector<OutFile>&);
 bool make_colorspace_mismatch(Context&, std::vector<OutFile>&);
 
-// 报告
+// 报告：manifest.txt（人读）与 manifest.json（含每个任务的计时与失败原因）
 bool write_manifest(const Context&, const std::vector<OutFile>&);
@@ -0,0 +1,172 @@
+#include "FrameSource.hpp"
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+bool frame_geometry(int w, int h, const std::string &pix, FrameGeometry &g) {
+  g = FrameGeometry{};
+  if (w <= 0 || h <= 0)
+    return false;
+  if (pix == "gray") {
+    g.planes = 1;
+  } else if (pix == "yuv420p" || pix == "yuvj420p") {
+    g.planes = 3;
+    g.cw_shift = 1;
+    g.ch_shift = 1;
+  } else if (pix == "yuv422p" || pix == "yuvj422p") {
+    g.planes = 3;
+    g.cw_shift = 1;
+  } else if (pix == "yuv444p" || pix == "yuvj444p") {
+    g.planes = 3;
+  } else {
+    return false;
+  }
+  size_t off = 0;
+  for (int i = 0; i < g.planes; ++i) {
+    PlaneGeom &pg = g.plane[i];
+    // 色度尺寸向上取整，与 ffmpeg 的 AV_CEIL_RSHIFT 一致
+    pg.w = i ? (w + (1 << g.cw_shift) - 1) >> g.cw_shift : w;
+    pg.h = i ? (h + (1 << g.ch_shift) - 1) >> g.ch_shift : h;
+    pg.offset = off;
+    pg.size = (size_t)pg.w * (size_t)pg.h;
+    off += pg.size;
+  }
+  g.frame_bytes = off;
+  return true;
+}
+
+bool MappedFile::open(const fs::path &p) {
+  close();
+#ifdef _WIN32
+  HANDLE f = CreateFileW(p.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ,
+                         nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                         nullptr);
+  if (f == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER sz{};
+  if (!GetFileSizeEx(f, &sz) || sz.QuadPart <= 0) {
+    CloseHandle(f);
+    return false;
+  }
+  HANDLE m = CreateFileMappingW(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!m) {
+    CloseHandle(f);
+    return false;
+  }
+  void *v = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+  if (!v) {
+    CloseHandle(m);
+    CloseHandle(f);
+    return false;
+  }
+  file_ = f;
+  map_ = m;
+  data_ = static_cast<const uint8_t *>(v);
+  size_ = (size_t)sz.QuadPart;
+#else
+  int fd = ::open(p.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+  void *v = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // 映射建立后即可关闭 fd
+  if (v == MAP_FAILED)
+    return false;
+  data_ = static_cast<const uint8_t *>(v);
+  size_ = (size_t)st.st_size;
+#endif
+  return true;
+}
+
+void MappedFile::close() {
+  if (!data_)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(data_);
+  CloseHandle((HANDLE)map_);
+  CloseHandle((HANDLE)file_);
+  map_ = file_ = nullptr;
+#else
+  munmap(const_cast<uint8_t *>(data_), size_);
+#endif
+  data_ = nullptr;
+  size_ = 0;
+}
+
+bool FrameSource::open(const fs::path &p, const FrameGeometry &g,
+                       size_t header_bytes) {
+  count_ = 0;
+  first_ = 0;
+  offsets_.reset();
+  if (!g.valid() || !file_.open(p))
+    return false;
+  geo_ = g;
+  header_ = header_bytes;
+  if (file_.size() > header_)
+    count_ = (file_.size() - header_) / g.frame_bytes;
+  return true;
+}
+
+bool FrameSource::open_indexed(
+    const fs::path &p, const FrameGeometry &g,
+    std::shared_ptr<const std::vector<uint64_t>> offsets) {
+  count_ = 0;
+  first_ = 0;
+  offsets_.reset();
+  if (!g.valid() || !offsets || !file_.open(p))
+    return false;
+  // 索引可能来自旧缓存：末帧越界即视为无效
+  if (!offsets->empty() && offsets->back() + g.frame_bytes > file_.size()) {
+    file_.close();
+    return false;
+  }
+  geo_ = g;
+  header_ = 0;
+  offsets_ = std::move(offsets);
+  count_ = offsets_->size();
+  return true;
+}
+
+void FrameSource::set_window(size_t first, size_t count) {
+  first = std::min(first, count_);
+  count_ = std::min(count, count_ - first);
+  first_ += first;
+}
+
+FrameView FrameSource::frame(size_t i) const {
+  FrameView v;
+  if (i >= count_)
+    return v;
+  i += first_;
+  const size_t off =
+      offsets_ ? (size_t)(*offsets_)[i] : header_ + i * geo_.frame_bytes;
+  const uint8_t *base = file_.data() + off;
+  v.planes = geo_.planes;
+  for (int k = 0; k < geo_.planes; ++k) {
+    const PlaneGeom &pg = geo_.plane[k];
+    v.p[k].data = base + pg.offset;
+    v.p[k].w = pg.w;
+    v.p[k].h = pg.h;
+    v.p[k].stride = (size_t)pg.w;
+  }
+  return v;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 平面几何：由 w/h/pix 推出每个平面的尺寸与帧内偏移（8-bit planar）
+struct PlaneGeom {
+    int w=0, h=0;
+    size_t offset=0; // 帧内字节偏移
+    size_t size=0;   // w*h
+};
+
+struct FrameGeometry {
+    int planes=0;        // 1=gray, 3=YUV
+    int cw_shift=0;      // 色度水平下采样（log2）
+    int ch_shift=0;      // 色度垂直下采样（log2）
+    PlaneGeom plane[3];
+    size_t frame_bytes=0;
+    bool valid() const { return planes>0 && frame_bytes>0; }
+};
+
+// 支持 yuv420p/yuv422p/yuv444p（含 yuvj*）与 gray；其余格式返回 false
+bool frame_geometry(int w, int h, const std::string& pix, FrameGeometry& g);
+
+struct PlaneView {
+    const uint8_t* data=nullptr;
+    int w=0, h=0;
+    size_t stride=0;
+    const uint8_t* row(int y) const { return data + (size_t)y*stride; }
+};
+
+struct FrameView {
+    int planes=0;
+    PlaneView p[3];
+    explicit operator bool() const { return planes>0; }
+};
+
+// 只读内存映射（POSIX mmap / Win32 MapViewOfFile），不可复制
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::filesystem::path& p);
+    void close();
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const uint8_t* data_=nullptr;
+    size_t size_=0;
+#ifdef _WIN32
+    void* file_=nullptr;
+    void* map_=nullptr;
+#endif
+};
+
+// 帧源（裸 YUV / 带索引的 y4m）：零拷贝访问任意帧的 Y/U/V 平面，O(1) 随机访问
+class FrameSource {
+public:
+    // header_bytes：文件头长度（裸 YUV 为 0）
+    bool open(const std::filesystem::path& p, const FrameGeometry& g,
+              size_t header_bytes=0);
+    // 按帧偏移索引打开（如 y4m：每帧前有 FRAME 行）
+    bool open_indexed(const std::filesystem::path& p, const FrameGeometry& g,
+                      std::shared_ptr<const std::vector<uint64_t>> offsets);
+    void close() { file_.close(); count_=0; first_=0; offsets_.reset(); }
+    // 只暴露 [first, first+count) 这段帧，之后的帧号相对 first（超出部分截断）
+    void set_window(size_t first, size_t count);
+
+    size_t frame_count() const { return count_; }
+    const FrameGeometry& geometry() const { return geo_; }
+    FrameView frame(size_t i) const; // 越界返回空视图
+
+private:
+    MappedFile file_;
+    FrameGeometry geo_;
+    size_t header_=0;
+    size_t count_=0;
+    size_t first_=0;
+    std::shared_ptr<const std::vector<uint64_t>> offsets_;
+};
@@ -0,0 +1,214 @@
+#include "Hash.hpp"
+#include "FrameSource.hpp"
+#include "Jobs.hpp"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t P0 = 0xa0761d6478bd642fULL;
+constexpr uint64_t P1 = 0xe7037ed1a0b428dbULL;
+constexpr uint64_t P2 = 0x8ebc6af09c88c6e3ULL;
+constexpr uint64_t P3 = 0x589965cc75374cc3ULL;
+
+inline uint64_t mum(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+  const __uint128_t r = (__uint128_t)a * b;
+  return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+  // 无 128 位整数时拆成 32 位分量
+  const uint64_t ha = a >> 32, la = (uint32_t)a, hb = b >> 32, lb = (uint32_t)b;
+  const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  const uint64_t t = rl + (rm0 << 32);
+  uint64_t lo = t + (rm1 << 32);
+  uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+  return lo ^ hi;
+#endif
+}
+
+inline uint64_t rd64(const uint8_t *p) {
+  uint64_t v;
+  std::memcpy(&v, p, 8);
+  return v;
+}
+
+constexpr size_t kChunk = 16u << 20;
+
+// 唯一的后台哈希线程：多个片段（批处理）排队执行，避免同时争抢内存带宽
+struct HashQueue {
+  std::mutex mu;
+  std::condition_variable cv;
+  std::deque<std::shared_ptr<HashJob>> q;
+  bool stop = false;
+  std::thread th;
+
+  void push(std::shared_ptr<HashJob> j) {
+    std::lock_guard<std::mutex> lk(mu);
+    if (!th.joinable())
+      th = std::thread([this] { loop(); });
+    q.push_back(std::move(j));
+    cv.notify_one();
+  }
+  void loop() {
+    for (;;) {
+      std::shared_ptr<HashJob> j;
+      {
+        std::unique_lock<std::mutex> lk(mu);
+        cv.wait(lk, [&] { return stop || !q.empty(); });
+        if (stop) // 退出时丢弃未开始的作业
+          return;
+        j = std::move(q.front());
+        q.pop_front();
+      }
+      j->run();
+    }
+  }
+  ~HashQueue() {
+    {
+      std::lock_guard<std::mutex> lk(mu);
+      stop = true;
+    }
+    cv.notify_all();
+    if (th.joinable())
+      th.join();
+  }
+};
+
+void put64(std::string &b, uint64_t v) {
+  for (int i = 0; i < 8; ++i, v >>= 8)
+    b += (char)(v & 0xff);
+}
+
+} // namespace
+
+uint64_t hash64(const void *data, size_t n, uint64_t seed) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  const size_t len = n;
+  uint64_t s0 = seed ^ mum(seed ^ P0, P1), s1 = s0, s2 = s0;
+  for (; n >= 48; n -= 48, p += 48) {
+    s0 = mum(rd64(p) ^ P1, rd64(p + 8) ^ s0);
+    s1 = mum(rd64(p + 16) ^ P2, rd64(p + 24) ^ s1);
+    s2 = mum(rd64(p + 32) ^ P3, rd64(p + 40) ^ s2);
+  }
+  uint64_t s = s0 ^ s1 ^ s2;
+  for (; n >= 16; n -= 16, p += 16)
+    s = mum(rd64(p) ^ P1, rd64(p + 8) ^ s);
+  if (n) {
+    uint8_t tail[16] = {};
+    std::memcpy(tail, p, n);
+    s = mum(rd64(tail) ^ P2, rd64(tail + 8) ^ s ^ n);
+  }
+  return mum(s ^ P1, (uint64_t)len ^ P0);
+}
+
+bool hash_file(const std::filesystem::path &p, int workers, uint64_t &out) {
+  MappedFile f;
+  if (!f.open(p))
+    return false;
+  const size_t chunks = (f.size() + kChunk - 1) / kChunk;
+  std::vector<uint64_t> h(chunks);
+  run_jobs(chunks, workers, [&](size_t i) {
+    const size_t off = i * kChunk;
+    h[i] = hash64(f.data() + off, std::min(kChunk, f.size() - off), i);
+  });
+  out = hash64(h.data(), h.size() * sizeof(uint64_t), f.size());
+  return true;
+}
+
+std::string hex64(uint64_t v) {
+  static const char *d = "0123456789abcdef";
+  std::string s(16, '0');
+  for (int i = 15; i >= 0; --i, v >>= 4)
+    s[i] = d[v & 15];
+  return s;
+}
+
+void HashJob::run() {
+  InputHashes r;
+  if (count_ > 0) {
+    // 帧窗口：只读窗口内的帧，file 取逐帧哈希序列的哈希
+    FrameSource src;
+    if (geo_.valid() && (offsets_ ? src.open_indexed(path_, geo_, offsets_)
+                                  : src.open(path_, geo_))) {
+      src.set_window(first_, count_);
+      r.frame_bytes = geo_.frame_bytes;
+      r.frames.resize(src.frame_count());
+      run_jobs(r.frames.size(), workers_, [&](size_t i) {
+        r.frames[i] = hash64(src.frame(i).p[0].data, geo_.frame_bytes);
+      });
+    }
+    r.windowed = true;
+    r.ok = r.frame_bytes > 0;
+    r.file = hash64(r.frames.data(), r.frames.size() * sizeof(uint64_t));
+  } else {
+    // 整个文件只读一遍：按 hash_file 的分块并行，每块算完分块哈希后接着算起点
+    // 落在块内的帧（页面仍在缓存中）；整文件哈希与 hash_file 的结果相同
+    MappedFile f;
+    if (f.open(path_)) {
+      const size_t fb = geo_.valid() ? geo_.frame_bytes : 0;
+      auto frame_off = [&](size_t k) {
+        return offsets_ ? (size_t)(*offsets_)[k] : k * fb;
+      };
+      size_t n = fb == 0 ? 0 : offsets_ ? offsets_->size() : f.size() / fb;
+      while (n > 0 && frame_off(n - 1) + fb > f.size())
+        --n;
+      r.frame_bytes = fb;
+      r.frames.resize(n);
+      const size_t chunks = (f.size() + kChunk - 1) / kChunk;
+      std::vector<uint64_t> h(chunks);
+      run_jobs(chunks, workers_, [&](size_t i) {
+        const size_t off = i * kChunk;
+        const size_t end = off + std::min(kChunk, f.size() - off);
+        h[i] = hash64(f.data() + off, end - off, i);
+        size_t k = offsets_ ? (size_t)(std::lower_bound(offsets_->begin(),
+                                                        offsets_->begin() + n,
+                                                        (uint64_t)off) -
+                                       offsets_->begin())
+                            : (fb ? (off + fb - 1) / fb : n);
+        for (; k < n && frame_off(k) < end; ++k)
+          r.frames[k] = hash64(f.data() + frame_off(k), fb);
+      });
+      r.file = hash64(h.data(), h.size() * sizeof(uint64_t), f.size());
+      r.ok = true;
+    }
+  }
+  std::lock_guard<std::mutex> lk(mu_);
+  res_ = std::move(r);
+  done_ = true;
+  cv_.notify_all();
+}
+
+const InputHashes &HashJob::wait() {
+  std::unique_lock<std::mutex> lk(mu_);
+  cv_.wait(lk, [&] { return done_; });
+  return res_;
+}
+
+std::shared_ptr<HashJob>
+hash_input_async(const std::filesystem::path &p, const FrameGeometry &g,
+                 std::shared_ptr<const std::vector<uint64_t>> offsets,
+                 int workers, size_t first, size_t count) {
+  static HashQueue queue;
+  auto j = std::make_shared<HashJob>(p, g, std::move(offsets), workers, first,
+                                     count);
+  queue.push(j);
+  return j;
+}
+
+bool write_input_hashes(const std::filesystem::path &p, const InputHashes &h) {
+  std::string b = "YCFH";
+  b += std::string("\x01\0\0\0", 4);
+  b += std::string(1, h.windowed ? '\x01' : '\0') + std::string(3, '\0');
+  put64(b, h.file);
+  put64(b, h.frame_bytes);
+  put64(b, h.frames.size());
+  for (uint64_t v : h.frames)
+    put64(b, v);
+  std::ofstream ofs(p, std::ios::binary | std::ios::trunc);
+  ofs.write(b.data(), (std::streamsize)b.size());
+  return (bool)ofs;
+}
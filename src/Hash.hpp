@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "FrameSource.hpp"
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 快速非加密 64-bit 哈希（wyhash 式 64×64→128 乘法折叠，每轮 48 字节三路并行）
+uint64_t hash64(const void* data, size_t n, uint64_t seed=0);
+inline uint64_t hash64(const std::string& s, uint64_t seed=0) {
+    return hash64(s.data(), s.size(), seed);
+}
+
+// 整个文件的哈希：映射后按 16 MiB 分块并行计算，再对分块哈希序列求哈希。
+// 结果与 workers 无关；失败返回 false
+bool hash_file(const std::filesystem::path& p, int workers, uint64_t& out);
+
+// 16 位十六进制
+std::string hex64(uint64_t v);
+
+// 输入指纹：整文件哈希 + 逐帧像素数据哈希（y4m 不含 FRAME 行；相同内容的帧哈希相同）
+struct InputHashes {
+    bool ok=false;
+    bool windowed=false;          // 只哈希了帧窗口：file 为窗口内逐帧哈希序列的哈希
+    uint64_t file=0;
+    uint64_t frame_bytes=0;       // 0 表示格式不支持逐帧哈希
+    std::vector<uint64_t> frames; // 按帧序号
+};
+
+// 后台哈希作业：由进程内唯一的哈希线程按提交顺序执行，与编码任务重叠。
+// 整文件时逐帧哈希与整文件哈希在同一遍读取中完成（file 与 hash_file 一致）
+class HashJob {
+public:
+    HashJob(std::filesystem::path p, const FrameGeometry& g,
+            std::shared_ptr<const std::vector<uint64_t>> offsets, int workers,
+            size_t first=0, size_t count=0)
+        : path_(std::move(p)), geo_(g), offsets_(std::move(offsets)), workers_(workers),
+          first_(first), count_(count) {}
+    void run();                // 由哈希线程调用
+    const InputHashes& wait(); // 阻塞至完成
+
+private:
+    std::filesystem::path path_;
+    FrameGeometry geo_;
+    std::shared_ptr<const std::vector<uint64_t>> offsets_;
+    int workers_=1;
+    size_t first_=0, count_=0; // 帧窗口，count_=0 表示整个文件
+    InputHashes res_;
+    bool done_=false;
+    std::mutex mu_;
+    std::condition_variable cv_;
+};
+
+// 提交作业；offsets 非空时按帧偏移索引（y4m），否则按 frame_bytes 连续切分。
+// count>0 时只哈希 [first, first+count) 帧，不读整个文件
+std::shared_ptr<HashJob> hash_input_async(const std::filesystem::path& p, const FrameGeometry& g,
+                                          std::shared_ptr<const std::vector<uint64_t>> offsets,
+                                          int workers, size_t first=0, size_t count=0);
+
+// 二进制旁路文件（小端）："YCFH" u32 版本=1 u32 标志(bit0=windowed) | u64 文件哈希 |
+// u64 帧字节 | u64 帧数 N | N × u64 帧哈希
+bool write_input_hashes(const std::filesystem::path& p, const InputHashes& h);
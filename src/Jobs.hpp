@@ -0,0 +1,30 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+inline int hw_threads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? (int)n : 1;
+}
+
+// 简单工作池：workers 个线程依次领取 [0, n) 的任务；workers<=1 时串行执行
+inline void run_jobs(size_t n, int workers, const std::function<void(size_t)>& fn) {
+    if (workers <= 1 || n <= 1) {
+        for (size_t i=0;i<n;++i) fn(i);
+        return;
+    }
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> pool;
+    const size_t k = std::min(n, (size_t)workers);
+    pool.reserve(k);
+    for (size_t t=0;t<k;++t) {
+        pool.emplace_back([&]() {
+            for (size_t i; (i = next.fetch_add(1)) < n;) fn(i);
+        });
+    }
+    for (auto& th : pool) th.join();
+}
@@ -0,0 +1,814 @@
+#include "Kernels.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define YC_X86 1
+#include <immintrin.h>
+// Win64 上 GCC 不保证 32 字节栈对齐（AVX 溢出寄存器会崩溃），只启用 SSSE3
+#ifndef _WIN32
+#define YC_AVX2 1
+#endif
+#endif
+
+namespace {
+
+void lut8_scalar(const uint8_t *src, uint8_t *dst, size_t n,
+                 const uint8_t *lut) {
+  for (size_t i = 0; i < n; ++i)
+    dst[i] = lut[src[i]];
+}
+
+void avg8_scalar(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t n) {
+  for (size_t i = 0; i < n; ++i)
+    dst[i] = (uint8_t)((a[i] + b[i] + 1) >> 1);
+}
+
+void blend8_scalar(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t n,
+                   int w) {
+  const int wa = 256 - w;
+  for (size_t i = 0; i < n; ++i)
+    dst[i] = (uint8_t)((a[i] * wa + b[i] * w + 128) >> 8);
+}
+
+// acc[i] += s[i] * t（和为 256 的 Q8 系数下 16 位累加不会溢出）
+void mac16_scalar(uint16_t *acc, const uint8_t *s, uint16_t t, size_t n) {
+  for (size_t i = 0; i < n; ++i)
+    acc[i] = (uint16_t)(acc[i] + s[i] * t);
+}
+
+void narrow16_scalar(const uint16_t *acc, uint8_t *dst, size_t n) {
+  for (size_t i = 0; i < n; ++i)
+    dst[i] = (uint8_t)((acc[i] + 128) >> 8);
+}
+
+void unsharp8_scalar(const uint8_t *src, const uint8_t *blur, uint8_t *dst,
+                     size_t n, int amount) {
+  for (size_t i = 0; i < n; ++i) {
+    const int v = src[i] + (((src[i] - blur[i]) * amount + 128) >> 8);
+    dst[i] = (uint8_t)std::clamp(v, 0, 255);
+  }
+}
+
+// 计数器哈希（lowbias32）：同一 (key, x) 总得到同一值，与调用顺序、分块方式无关
+inline uint32_t mix32(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352dU;
+  x ^= x >> 15;
+  x *= 0x846ca68bU;
+  x ^= x >> 16;
+  return x;
+}
+
+void grain8_scalar(const uint8_t *src, uint8_t *dst, size_t n, uint32_t key,
+                   uint32_t x0, int strength) {
+  for (size_t i = 0; i < n; ++i) {
+    const int v = src[i] +
+                  (int)(((mix32(key + x0 + (uint32_t)i) >> 24) *
+                         (uint32_t)strength) >> 8) -
+                  (strength >> 1);
+    dst[i] = (uint8_t)std::clamp(v, 0, 255);
+  }
+}
+
+void ycc_row_scalar(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                    uint8_t *dst, size_t n, int hshift, const int16_t *m,
+                    int32_t off) {
+  for (size_t i = 0; i < n; ++i) {
+    const size_t c = i >> hshift;
+    const int r = (m[0] * y[i] + m[1] * (u[c] - 128) + m[2] * (v[c] - 128) +
+                   off) >> 14;
+    dst[i] = (uint8_t)std::clamp(r, 0, 255);
+  }
+}
+
+// acc[i] += add[i] - sub[i]（方框模糊的列和滑动）
+void slide16_scalar(uint16_t *acc, const uint8_t *add, const uint8_t *sub,
+                    size_t n) {
+  for (size_t i = 0; i < n; ++i)
+    acc[i] = (uint16_t)(acc[i] + add[i] - sub[i]);
+}
+
+#ifdef YC_X86
+__attribute__((target("ssse3"))) void
+slide16_ssse3(uint16_t *acc, const uint8_t *add, const uint8_t *sub, size_t n) {
+  const __m128i z = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(add + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sub + i));
+    __m128i *p = reinterpret_cast<__m128i *>(acc + i);
+    _mm_storeu_si128(
+        p, _mm_sub_epi16(_mm_add_epi16(_mm_loadu_si128(p),
+                                       _mm_unpacklo_epi8(a, z)),
+                         _mm_unpacklo_epi8(b, z)));
+    _mm_storeu_si128(
+        p + 1, _mm_sub_epi16(_mm_add_epi16(_mm_loadu_si128(p + 1),
+                                           _mm_unpackhi_epi8(a, z)),
+                             _mm_unpackhi_epi8(b, z)));
+  }
+  slide16_scalar(acc + i, add + i, sub + i, n - i);
+}
+#endif
+
+#ifdef YC_X86
+// pmaddwd 两两配对：(y, u') × (m0, m1) 与 (v', 0) × (m2, 0)，得到 32 位和
+__attribute__((target("ssse3"))) inline __m128i
+ycc_dot_ssse3(__m128i y, __m128i u, __m128i v, __m128i m01, __m128i m2,
+              __m128i off) {
+  const __m128i z = _mm_setzero_si128();
+  __m128i lo = _mm_add_epi32(
+      _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(y, u), m01),
+                    _mm_madd_epi16(_mm_unpacklo_epi16(v, z), m2)),
+      off);
+  __m128i hi = _mm_add_epi32(
+      _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(y, u), m01),
+                    _mm_madd_epi16(_mm_unpackhi_epi16(v, z), m2)),
+      off);
+  return _mm_packs_epi32(_mm_srai_epi32(lo, 14), _mm_srai_epi32(hi, 14));
+}
+
+__attribute__((target("ssse3"))) void
+ycc_row_ssse3(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+              uint8_t *dst, size_t n, int hshift, const int16_t *m,
+              int32_t off) {
+  const __m128i z = _mm_setzero_si128();
+  const __m128i c128 = _mm_set1_epi16(128);
+  const __m128i m01 = _mm_set1_epi32((int)(uint16_t)m[0] | ((int)m[1] << 16));
+  const __m128i m2 = _mm_set1_epi32((int)(uint16_t)m[2]);
+  const __m128i ov = _mm_set1_epi32(off);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i cu, cv;
+    if (hshift) {
+      // 4 个色度样本各复制一次，对齐到 8 个亮度样本
+      int32_t a, b;
+      std::memcpy(&a, u + (i >> 1), 4);
+      std::memcpy(&b, v + (i >> 1), 4);
+      cu = _mm_cvtsi32_si128(a);
+      cv = _mm_cvtsi32_si128(b);
+      cu = _mm_unpacklo_epi8(cu, cu);
+      cv = _mm_unpacklo_epi8(cv, cv);
+    } else {
+      cu = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + i));
+      cv = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + i));
+    }
+    __m128i y16 = _mm_unpacklo_epi8(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(y + i)), z);
+    __m128i r = ycc_dot_ssse3(y16, _mm_sub_epi16(_mm_unpacklo_epi8(cu, z), c128),
+                              _mm_sub_epi16(_mm_unpacklo_epi8(cv, z), c128),
+                              m01, m2, ov);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i),
+                     _mm_packus_epi16(r, r));
+  }
+  ycc_row_scalar(y + i, u + (i >> hshift), v + (i >> hshift), dst + i, n - i,
+                 hshift, m, off);
+}
+
+// SSSE3 没有 pmulld：奇偶两组 pmuludq 再拼回 4 个 32 位低半积
+__attribute__((target("ssse3"))) inline __m128i mul32_ssse3(__m128i a,
+                                                            __m128i b) {
+  __m128i e = _mm_mul_epu32(a, b);
+  __m128i o = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(e, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(o, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+__attribute__((target("ssse3"))) inline __m128i mix32_ssse3(__m128i x) {
+  x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+  x = mul32_ssse3(x, _mm_set1_epi32((int)0x7feb352dU));
+  x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+  x = mul32_ssse3(x, _mm_set1_epi32((int)0x846ca68bU));
+  return _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+}
+
+__attribute__((target("ssse3"))) void
+grain8_ssse3(const uint8_t *src, uint8_t *dst, size_t n, uint32_t key,
+             uint32_t x0, int strength) {
+  const __m128i z = _mm_setzero_si128();
+  const __m128i st = _mm_set1_epi16((short)strength);
+  const __m128i half = _mm_set1_epi16((short)(strength >> 1));
+  const __m128i step = _mm_set1_epi32(8);
+  __m128i c0 = _mm_add_epi32(_mm_set1_epi32((int)(key + x0)),
+                             _mm_setr_epi32(0, 1, 2, 3));
+  __m128i c1 = _mm_add_epi32(c0, _mm_set1_epi32(4));
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i r = _mm_packs_epi32(_mm_srli_epi32(mix32_ssse3(c0), 24),
+                                _mm_srli_epi32(mix32_ssse3(c1), 24));
+    __m128i d = _mm_sub_epi16(_mm_srli_epi16(_mm_mullo_epi16(r, st), 8), half);
+    __m128i v = _mm_add_epi16(
+        _mm_unpacklo_epi8(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i)), z),
+        d);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i),
+                     _mm_packus_epi16(v, v));
+    c0 = _mm_add_epi32(c0, step);
+    c1 = _mm_add_epi32(c1, step);
+  }
+  grain8_scalar(src + i, dst + i, n - i, key, x0 + (uint32_t)i, strength);
+}
+
+__attribute__((target("ssse3"))) void
+mac16_ssse3(uint16_t *acc, const uint8_t *s, uint16_t t, size_t n) {
+  const __m128i z = _mm_setzero_si128();
+  const __m128i tv = _mm_set1_epi16((short)t);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+    __m128i *a = reinterpret_cast<__m128i *>(acc + i);
+    _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a),
+                                      _mm_mullo_epi16(_mm_unpacklo_epi8(x, z),
+                                                      tv)));
+    _mm_storeu_si128(a + 1,
+                     _mm_add_epi16(_mm_loadu_si128(a + 1),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(x, z),
+                                                   tv)));
+  }
+  mac16_scalar(acc + i, s + i, t, n - i);
+}
+
+__attribute__((target("ssse3"))) void
+narrow16_ssse3(const uint16_t *acc, uint8_t *dst, size_t n) {
+  const __m128i rnd = _mm_set1_epi16(128);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i *a = reinterpret_cast<const __m128i *>(acc + i);
+    __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_loadu_si128(a), rnd), 8);
+    __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_loadu_si128(a + 1), rnd), 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     _mm_packus_epi16(lo, hi));
+  }
+  narrow16_scalar(acc + i, dst + i, n - i);
+}
+
+// (src-blur)*amount 可能超出 16 位：mullo/mulhi 拼成 32 位积再移位、饱和收窄
+__attribute__((target("ssse3"))) void
+unsharp8_ssse3(const uint8_t *src, const uint8_t *blur, uint8_t *dst, size_t n,
+               int amount) {
+  const __m128i z = _mm_setzero_si128();
+  const __m128i am = _mm_set1_epi16((short)amount);
+  const __m128i rnd = _mm_set1_epi32(128);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i s16 = _mm_unpacklo_epi8(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i)), z);
+    __m128i b16 = _mm_unpacklo_epi8(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(blur + i)), z);
+    __m128i d = _mm_sub_epi16(s16, b16);
+    __m128i lo = _mm_mullo_epi16(d, am), hi = _mm_mulhi_epi16(d, am);
+    __m128i p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), rnd), 8);
+    __m128i p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), rnd), 8);
+    __m128i v = _mm_adds_epi16(s16, _mm_packs_epi32(p0, p1));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i),
+                     _mm_packus_epi16(v, v));
+  }
+  unsharp8_scalar(src + i, blur + i, dst + i, n - i, amount);
+}
+
+// pavgb：SSE2 即有，随 SSSE3 路径一起启用
+__attribute__((target("ssse3"))) void
+avg8_ssse3(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+    __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_avg_epu8(x, y));
+  }
+  avg8_scalar(a + i, b + i, dst + i, n - i);
+}
+
+// 8 个像素一组扩展到 16 位：a*(256-w) + b*w 最大 65280，无符号 16 位不溢出
+__attribute__((target("ssse3"))) void
+blend8_ssse3(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t n,
+             int w) {
+  const __m128i z = _mm_setzero_si128();
+  const __m128i wa = _mm_set1_epi16((short)(256 - w));
+  const __m128i wb = _mm_set1_epi16((short)w);
+  const __m128i rnd = _mm_set1_epi16(128);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+    __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+    __m128i lo = _mm_add_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(x, z), wa),
+                      _mm_mullo_epi16(_mm_unpacklo_epi8(y, z), wb)),
+        rnd);
+    __m128i hi = _mm_add_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(x, z), wa),
+                      _mm_mullo_epi16(_mm_unpackhi_epi8(y, z), wb)),
+        rnd);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     _mm_packus_epi16(_mm_srli_epi16(lo, 8),
+                                      _mm_srli_epi16(hi, 8)));
+  }
+  blend8_scalar(a + i, b + i, dst + i, n - i, w);
+}
+
+// 256 项查表拆成 16 张 16 字节子表：低 4 位做 pshufb 索引，高 4 位选子表
+__attribute__((target("ssse3"))) void
+lut8_ssse3(const uint8_t *src, uint8_t *dst, size_t n, const uint8_t *lut) {
+  __m128i tab[16];
+  for (int k = 0; k < 16; ++k)
+    tab[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lut + 16 * k));
+  const __m128i nib = _mm_set1_epi8(0x0F);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i lo = _mm_and_si128(x, nib);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), nib);
+    __m128i r = _mm_setzero_si128();
+    for (int k = 0; k < 16; ++k) {
+      __m128i sel = _mm_cmpeq_epi8(hi, _mm_set1_epi8((char)k));
+      r = _mm_or_si128(r, _mm_and_si128(sel, _mm_shuffle_epi8(tab[k], lo)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), r);
+  }
+  lut8_scalar(src + i, dst + i, n - i, lut);
+}
+#endif
+
+#ifdef YC_AVX2
+__attribute__((target("avx2"))) void
+lut8_avx2(const uint8_t *src, uint8_t *dst, size_t n, const uint8_t *lut) {
+  __m256i tab[16];
+  for (int k = 0; k < 16; ++k)
+    tab[k] = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(lut + 16 * k)));
+  const __m256i nib = _mm256_set1_epi8(0x0F);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    __m256i lo = _mm256_and_si256(x, nib);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), nib);
+    __m256i r = _mm256_setzero_si256();
+    for (int k = 0; k < 16; ++k) {
+      __m256i sel = _mm256_cmpeq_epi8(hi, _mm256_set1_epi8((char)k));
+      r = _mm256_or_si256(
+          r, _mm256_and_si256(sel, _mm256_shuffle_epi8(tab[k], lo)));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), r);
+  }
+  lut8_scalar(src + i, dst + i, n - i, lut);
+}
+#endif
+
+#ifdef YC_AVX2
+__attribute__((target("avx2"))) void
+avg8_avx2(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t n) {
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                        _mm256_avg_epu8(x, y));
+  }
+  avg8_scalar(a + i, b + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline __m256i mix32_avx2(__m256i x) {
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+  x = _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x7feb352dU));
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+  x = _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x846ca68bU));
+  return _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+}
+
+__attribute__((target("avx2"))) void
+grain8_avx2(const uint8_t *src, uint8_t *dst, size_t n, uint32_t key,
+            uint32_t x0, int strength) {
+  const __m256i st = _mm256_set1_epi16((short)strength);
+  const __m256i half = _mm256_set1_epi16((short)(strength >> 1));
+  const __m256i step = _mm256_set1_epi32(16);
+  __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32((int)(key + x0)),
+                                _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  __m256i c1 = _mm256_add_epi32(c0, _mm256_set1_epi32(8));
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    // packs 按 128 位通道交错两组计数器，permute 恢复 0..15 的顺序
+    __m256i r = _mm256_permute4x64_epi64(
+        _mm256_packs_epi32(_mm256_srli_epi32(mix32_avx2(c0), 24),
+                           _mm256_srli_epi32(mix32_avx2(c1), 24)),
+        0xD8);
+    __m256i d = _mm256_sub_epi16(
+        _mm256_srli_epi16(_mm256_mullo_epi16(r, st), 8), half);
+    __m256i v = _mm256_add_epi16(
+        _mm256_cvtepu8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i))),
+        d);
+    __m256i u8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0xD8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     _mm256_castsi256_si128(u8));
+    c0 = _mm256_add_epi32(c0, step);
+    c1 = _mm256_add_epi32(c1, step);
+  }
+  grain8_scalar(src + i, dst + i, n - i, key, x0 + (uint32_t)i, strength);
+}
+
+__attribute__((target("avx2"))) void
+ycc_row_avx2(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+             uint8_t *dst, size_t n, int hshift, const int16_t *m,
+             int32_t off) {
+  const __m256i z = _mm256_setzero_si256();
+  const __m256i c128 = _mm256_set1_epi16(128);
+  const __m256i m01 =
+      _mm256_set1_epi32((int)(uint16_t)m[0] | ((int)m[1] << 16));
+  const __m256i m2 = _mm256_set1_epi32((int)(uint16_t)m[2]);
+  const __m256i ov = _mm256_set1_epi32(off);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i cu, cv;
+    if (hshift) {
+      cu = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + (i >> 1)));
+      cv = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + (i >> 1)));
+      cu = _mm_unpacklo_epi8(cu, cu);
+      cv = _mm_unpacklo_epi8(cv, cv);
+    } else {
+      cu = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + i));
+      cv = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + i));
+    }
+    __m256i y16 = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + i)));
+    __m256i u16 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(cu), c128);
+    __m256i v16 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(cv), c128);
+    // unpack/packs 都在 128 位通道内，配对后的顺序经 packs 复原
+    __m256i lo = _mm256_add_epi32(
+        _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(y16, u16), m01),
+                         _mm256_madd_epi16(_mm256_unpacklo_epi16(v16, z), m2)),
+        ov);
+    __m256i hi = _mm256_add_epi32(
+        _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(y16, u16), m01),
+                         _mm256_madd_epi16(_mm256_unpackhi_epi16(v16, z), m2)),
+        ov);
+    __m256i r = _mm256_packs_epi32(_mm256_srai_epi32(lo, 14),
+                                   _mm256_srai_epi32(hi, 14));
+    __m256i u8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(r, r), 0xD8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     _mm256_castsi256_si128(u8));
+  }
+  ycc_row_scalar(y + i, u + (i >> hshift), v + (i >> hshift), dst + i, n - i,
+                 hshift, m, off);
+}
+
+// vpmovzxbw 直接得到线性排列的 16 个 16 位值，累加器无需跨通道重排
+__attribute__((target("avx2"))) void
+mac16_avx2(uint16_t *acc, const uint8_t *s, uint16_t t, size_t n) {
+  const __m256i tv = _mm256_set1_epi16((short)t);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i x = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)));
+    __m256i *a = reinterpret_cast<__m256i *>(acc + i);
+    _mm256_storeu_si256(
+        a, _mm256_add_epi16(_mm256_loadu_si256(a), _mm256_mullo_epi16(x, tv)));
+  }
+  mac16_scalar(acc + i, s + i, t, n - i);
+}
+
+__attribute__((target("avx2"))) void
+narrow16_avx2(const uint16_t *acc, uint8_t *dst, size_t n) {
+  const __m256i rnd = _mm256_set1_epi16(128);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const __m256i *a = reinterpret_cast<const __m256i *>(acc + i);
+    __m256i lo =
+        _mm256_srli_epi16(_mm256_add_epi16(_mm256_loadu_si256(a), rnd), 8);
+    __m256i hi =
+        _mm256_srli_epi16(_mm256_add_epi16(_mm256_loadu_si256(a + 1), rnd), 8);
+    // packus 按 128 位通道交错，permute 恢复线性顺序
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i *>(dst + i),
+        _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8));
+  }
+  narrow16_scalar(acc + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) void
+unsharp8_avx2(const uint8_t *src, const uint8_t *blur, uint8_t *dst, size_t n,
+              int amount) {
+  const __m256i am = _mm256_set1_epi16((short)amount);
+  const __m256i rnd = _mm256_set1_epi32(128);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i s16 = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+    __m256i b16 = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(blur + i)));
+    __m256i d = _mm256_sub_epi16(s16, b16);
+    __m256i lo = _mm256_mullo_epi16(d, am), hi = _mm256_mulhi_epi16(d, am);
+    // unpack 与 packs 都在通道内，组合后顺序不变
+    __m256i p0 = _mm256_srai_epi32(
+        _mm256_add_epi32(_mm256_unpacklo_epi16(lo, hi), rnd), 8);
+    __m256i p1 = _mm256_srai_epi32(
+        _mm256_add_epi32(_mm256_unpackhi_epi16(lo, hi), rnd), 8);
+    __m256i v = _mm256_adds_epi16(s16, _mm256_packs_epi32(p0, p1));
+    __m256i u8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0xD8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     _mm256_castsi256_si128(u8));
+  }
+  unsharp8_scalar(src + i, blur + i, dst + i, n - i, amount);
+}
+
+// unpack 在 128 位通道内进行，packus 也按通道拼回，顺序保持不变
+__attribute__((target("avx2"))) void
+blend8_avx2(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t n,
+            int w) {
+  const __m256i z = _mm256_setzero_si256();
+  const __m256i wa = _mm256_set1_epi16((short)(256 - w));
+  const __m256i wb = _mm256_set1_epi16((short)w);
+  const __m256i rnd = _mm256_set1_epi16(128);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    __m256i lo = _mm256_add_epi16(
+        _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(x, z), wa),
+                         _mm256_mullo_epi16(_mm256_unpacklo_epi8(y, z), wb)),
+        rnd);
+    __m256i hi = _mm256_add_epi16(
+        _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(x, z), wa),
+                         _mm256_mullo_epi16(_mm256_unpackhi_epi8(y, z), wb)),
+        rnd);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                        _mm256_packus_epi16(_mm256_srli_epi16(lo, 8),
+                                            _mm256_srli_epi16(hi, 8)));
+  }
+  blend8_scalar(a + i, b + i, dst + i, n - i, w);
+}
+#endif
+
+enum class Isa { Scalar, Ssse3, Avx2 };
+
+Isa detect_isa() {
+#ifdef YC_X86
+  __builtin_cpu_init();
+#ifdef YC_AVX2
+  if (__builtin_cpu_supports("avx2"))
+    return Isa::Avx2;
+#endif
+  if (__builtin_cpu_supports("ssse3"))
+    return Isa::Ssse3;
+#endif
+  return Isa::Scalar;
+}
+
+Isa isa() {
+  static const Isa v = detect_isa();
+  return v;
+}
+
+} // namespace
+
+void lut8_apply(const uint8_t *src, uint8_t *dst, size_t n,
+                const uint8_t lut[256]) {
+  switch (isa()) {
+#ifdef YC_AVX2
+  case Isa::Avx2:
+    lut8_avx2(src, dst, n, lut);
+    return;
+#endif
+#ifdef YC_X86
+  case Isa::Ssse3:
+    lut8_ssse3(src, dst, n, lut);
+    return;
+#endif
+  default:
+    lut8_scalar(src, dst, n, lut);
+  }
+}
+
+void avg8(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t n) {
+  switch (isa()) {
+#ifdef YC_AVX2
+  case Isa::Avx2:
+    avg8_avx2(a, b, dst, n);
+    return;
+#endif
+#ifdef YC_X86
+  case Isa::Ssse3:
+    avg8_ssse3(a, b, dst, n);
+    return;
+#endif
+  default:
+    avg8_scalar(a, b, dst, n);
+  }
+}
+
+void blend8(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t n,
+            int w) {
+  w = std::clamp(w, 0, 256);
+  switch (isa()) {
+#ifdef YC_AVX2
+  case Isa::Avx2:
+    blend8_avx2(a, b, dst, n, w);
+    return;
+#endif
+#ifdef YC_X86
+  case Isa::Ssse3:
+    blend8_ssse3(a, b, dst, n, w);
+    return;
+#endif
+  default:
+    blend8_scalar(a, b, dst, n, w);
+  }
+}
+
+static void mac16(uint16_t *acc, const uint8_t *s, uint16_t t, size_t n) {
+  switch (isa()) {
+#ifdef YC_AVX2
+  case Isa::Avx2:
+    mac16_avx2(acc, s, t, n);
+    return;
+#endif
+#ifdef YC_X86
+  case Isa::Ssse3:
+    mac16_ssse3(acc, s, t, n);
+    return;
+#endif
+  default:
+    mac16_scalar(acc, s, t, n);
+  }
+}
+
+static void narrow16(const uint16_t *acc, uint8_t *dst, size_t n) {
+  switch (isa()) {
+#ifdef YC_AVX2
+  case Isa::Avx2:
+    narrow16_avx2(acc, dst, n);
+    return;
+#endif
+#ifdef YC_X86
+  case Isa::Ssse3:
+    narrow16_ssse3(acc, dst, n);
+    return;
+#endif
+  default:
+    narrow16_scalar(acc, dst, n);
+  }
+}
+
+static void slide16(uint16_t *acc, const uint8_t *add, const uint8_t *sub,
+                    size_t n) {
+  // 单次只有一加一减，AVX2 相比 SSSE3 收益有限，统一用 128 位实现
+#ifdef YC_X86
+  if (isa() != Isa::Scalar) {
+    slide16_ssse3(acc, add, sub, n);
+    return;
+  }
+#endif
+  slide16_scalar(acc, add, sub, n);
+}
+
+void box8_running(const uint8_t *src, size_t src_stride, uint8_t *dst,
+                  size_t dst_stride, int w, int h, int radius, int y0,
+                  int y1) {
+  if (y1 < 0 || y1 > h)
+    y1 = h;
+  if (w <= 0 || y0 >= y1)
+    return;
+  radius = std::clamp(radius, 0, 16);
+  const int len = 2 * radius + 1;
+  const uint32_t inv = (65536u + (uint32_t)(len * len) / 2) / (uint32_t)(len * len);
+  const size_t n = (size_t)w;
+  auto row = [&](int y) {
+    return src + (size_t)std::clamp(y, 0, h - 1) * src_stride;
+  };
+  // 列和：第 y 行输出窗口 [y-r, y+r] 内各列之和，逐行滑动
+  std::vector<uint16_t> col(n, 0);
+  std::vector<uint8_t> zero(n, 0);
+  for (int k = -radius; k <= radius; ++k)
+    slide16(col.data(), row(y0 + k), zero.data(), n);
+  for (int y = y0; y < y1; ++y) {
+    // 横向滑动窗口，边缘复制
+    uint32_t sum = 0;
+    for (int k = -radius; k <= radius; ++k)
+      sum += col[(size_t)std::clamp(k, 0, w - 1)];
+    uint8_t *d = dst + (size_t)(y - y0) * dst_stride;
+    for (int x = 0; x < w; ++x) {
+      d[x] = (uint8_t)((sum * inv + 32768u) >> 16);
+      sum += col[(size_t)std::min(x + radius + 1, w - 1)];
+      sum -= col[(size_t)std::max(x - radius, 0)];
+    }
+    if (y + 1 < y1)
+      slide16(col.data(), row(y + radius + 1), row(y - radius), n);
+  }
+}
+
+void blur8_separable(const uint8_t *src, size_t src_stride, uint8_t *dst,
+                     size_t dst_stride, int w, int h, const uint16_t *taps,
+                     int radius, int y0, int y1) {
+  if (y1 < 0 || y1 > h)
+    y1 = h;
+  if (w <= 0 || y0 >= y1)
+    return;
+  // 行缓冲左右各留 radius 个复制的边缘样本，横向乘加无需判断边界
+  const size_t n = (size_t)w;
+  std::vector<uint16_t> acc(n);
+  std::vector<uint8_t> row(n + 2 * (size_t)radius);
+  uint8_t *r = row.data() + radius;
+  for (int y = y0; y < y1; ++y) {
+    std::fill(acc.begin(), acc.end(), 0);
+    for (int k = -radius; k <= radius; ++k)
+      mac16(acc.data(),
+            src + (size_t)std::clamp(y + k, 0, h - 1) * src_stride,
+            taps[k + radius], n);
+    narrow16(acc.data(), r, n);
+    for (int k = 1; k <= radius; ++k) {
+      r[-k] = r[0];
+      r[w - 1 + k] = r[w - 1];
+    }
+    std::fill(acc.begin(), acc.end(), 0);
+    for (int k = -radius; k <= radius; ++k)
+      mac16(acc.data(), r + k, taps[k + radius], n);
+    narrow16(acc.data(), dst + (size_t)(y - y0) * dst_stride, n);
+  }
+}
+
+void unsharp8(const uint8_t *src, const uint8_t *blur, uint8_t *dst, size_t n,
+              int amount) {
+  switch (isa()) {
+#ifdef YC_AVX2
+  case Isa::Avx2:
+    unsharp8_avx2(src, blur, dst, n, amount);
+    return;
+#endif
+#ifdef YC_X86
+  case Isa::Ssse3:
+    unsharp8_ssse3(src, blur, dst, n, amount);
+    return;
+#endif
+  default:
+    unsharp8_scalar(src, blur, dst, n, amount);
+  }
+}
+
+void grain8(const uint8_t *src, uint8_t *dst, size_t n, uint32_t key,
+            uint32_t x0, int strength) {
+  strength = std::clamp(strength, 0, 255);
+  switch (isa()) {
+#ifdef YC_AVX2
+  case Isa::Avx2:
+    grain8_avx2(src, dst, n, key, x0, strength);
+    return;
+#endif
+#ifdef YC_X86
+  case Isa::Ssse3:
+    grain8_ssse3(src, dst, n, key, x0, strength);
+    return;
+#endif
+  default:
+    grain8_scalar(src, dst, n, key, x0, strength);
+  }
+}
+
+void ycc_row(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+             uint8_t *dst, size_t n, int hshift, const int16_t m[3],
+             int32_t off) {
+  switch (isa()) {
+#ifdef YC_AVX2
+  case Isa::Avx2:
+    ycc_row_avx2(y, u, v, dst, n, hshift, m, off);
+    return;
+#endif
+#ifdef YC_X86
+  case Isa::Ssse3:
+    ycc_row_ssse3(y, u, v, dst, n, hshift, m, off);
+    return;
+#endif
+  default:
+    ycc_row_scalar(y, u, v, dst, n, hshift, m, off);
+  }
+}
+
+void hist8_accumulate(const uint8_t *src, size_t n, uint32_t hist[256]) {
+  uint32_t h[4][256] = {};
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t w;
+    std::memcpy(&w, src + i, sizeof(w));
+    ++h[0][w & 0xFF];
+    ++h[1][(w >> 8) & 0xFF];
+    ++h[2][(w >> 16) & 0xFF];
+    ++h[3][(w >> 24) & 0xFF];
+    ++h[0][(w >> 32) & 0xFF];
+    ++h[1][(w >> 40) & 0xFF];
+    ++h[2][(w >> 48) & 0xFF];
+    ++h[3][w >> 56];
+  }
+  for (; i < n; ++i)
+    ++h[0][src[i]];
+  for (int v = 0; v < 256; ++v)
+    hist[v] += h[0][v] + h[1][v] + h[2][v] + h[3][v];
+}
+
+const char *kernels_isa() {
+  switch (isa()) {
+  case Isa::Avx2:
+    return "avx2";
+  case Isa::Ssse3:
+    return "ssse3";
+  default:
+    return "scalar";
+  }
+}
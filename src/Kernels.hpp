@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// 8-bit 像素内核。x86 上按运行时 CPU 特性选择 AVX2/SSSE3 实现，其余回退标量
+
+// dst[i] = lut[src[i]]，src 与 dst 可相同
+void lut8_apply(const uint8_t* src, uint8_t* dst, size_t n, const uint8_t lut[256]);
+
+// dst[i] = (a[i] + b[i] + 1) >> 1，dst 可与 a 或 b 相同
+void avg8(const uint8_t* a, const uint8_t* b, uint8_t* dst, size_t n);
+
+// dst[i] = (a[i]*(256-w) + b[i]*w + 128) >> 8，w ∈ [0,256]（Q8 定点混合），dst 可与 a 或 b 相同
+void blend8(const uint8_t* a, const uint8_t* b, uint8_t* dst, size_t n, int w);
+
+// 可分离 FIR 模糊（高斯/方框）：taps 为 2*radius+1 个 Q8 系数（和为 256），边缘复制。
+// 逐行流式处理：纵向 2r+1 行乘加到 16-bit 行累加器，再对补边后的行做横向乘加；
+// 工作集只有 2r+1 个源行与两行缓冲，4K 下也留在 L2。src 与 dst 不可重叠。
+// 可只算 [y0, y1) 行（按整个平面补边），dst 指向第 y0 行的输出；y1<0 表示到底
+void blur8_separable(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+                     int w, int h, const uint16_t* taps, int radius, int y0=0, int y1=-1);
+
+// 方框模糊（running sum）：(2r+1)² 窗口均值，r ≤ 16，边缘复制。纵向以 16-bit 列和逐行
+// 一加一减滑动（SIMD），横向在列和上滑动，只舍入一次。src 与 dst 不可重叠。
+// y0/y1 含义同 blur8_separable（条带首行的列和由上下 halo 行初始化）
+void box8_running(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+                  int w, int h, int radius, int y0=0, int y1=-1);
+
+// 反锐化掩模：dst = clamp(src + ((src - blur) * amount + 128) >> 8)，amount 为 Q8（负值变为模糊）
+void unsharp8(const uint8_t* src, const uint8_t* blur, uint8_t* dst, size_t n, int amount);
+
+// 加性均匀颗粒：dst = clamp(src + ((h >> 24) * strength >> 8) - strength/2)，
+// h = mix32(key + x0 + i) 为计数器哈希。结果只取决于 (key, 列号)，任意行/分块可独立并行生成，
+// 与 ISA 无关、逐位一致。strength ∈ [0,255]，dst 可与 src 相同
+void grain8(const uint8_t* src, uint8_t* dst, size_t n, uint32_t key, uint32_t x0, int strength);
+
+// YCbCr 矩阵的一行输出（Q14）：dst[i] = clamp((m0*y[i] + m1*(u[c]-128) + m2*(v[c]-128) + off) >> 14)，
+// c = i >> hshift（hshift ∈ {0,1}，1 为亮度行取所在块的色度样本）；off 含舍入项
+void ycc_row(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, size_t n,
+             int hshift, const int16_t m[3], int32_t off);
+
+// hist[v] += count(src == v)；4 组子直方图交错计数，避免同一 bin 的写后读依赖
+void hist8_accumulate(const uint8_t* src, size_t n, uint32_t hist[256]);
+
+// 当前生效的实现名（"avx2" / "ssse3" / "scalar"），写入日志便于排查
+const char* kernels_isa();
@@ -0,0 +1,548 @@
+#include "Native.hpp"
+#include "Kernels.hpp"
+#include "Pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+LutStage::LutStage(const uint8_t (&lut)[256]) {
+  std::memcpy(lut_, lut, sizeof(lut_));
+}
+
+FrameView LutStage::apply(size_t, const FrameView &in) {
+  const PlaneView &y = in.p[0];
+  const size_t w = (size_t)y.w;
+  y_.resize(w * (size_t)y.h);
+  parallel_rows(y.h, [&](int y0, int y1) {
+    if (y.stride == w) {
+      lut8_apply(y.row(y0), y_.data() + (size_t)y0 * w, (size_t)(y1 - y0) * w,
+                 lut_);
+    } else {
+      for (int r = y0; r < y1; ++r)
+        lut8_apply(y.row(r), y_.data() + (size_t)r * w, w, lut_);
+    }
+  });
+  FrameView out = in;
+  out.p[0].data = y_.data();
+  out.p[0].stride = (size_t)y.w;
+  return out;
+}
+
+std::string LutStage::signature() const {
+  static const char *d = "0123456789abcdef";
+  std::string s = "lut:";
+  for (uint8_t v : lut_) {
+    s += d[v >> 4];
+    s += d[v & 15];
+  }
+  return s;
+}
+
+JitterStage::JitterStage(const FrameGeometry &g, int period, bool horiz,
+                         bool forward)
+    : geo_(g), period_(std::max(period, 1)), horiz_(horiz), forward_(forward) {}
+
+// 整像素环绕平移一行：forward 为右移（dst[0] 取末尾样本）
+static void rotate_row(const uint8_t *src, uint8_t *dst, int w, bool forward) {
+  if (w <= 1) {
+    std::memcpy(dst, src, (size_t)w);
+    return;
+  }
+  if (forward) {
+    dst[0] = src[w - 1];
+    std::memcpy(dst + 1, src, (size_t)w - 1);
+  } else {
+    std::memcpy(dst, src + 1, (size_t)w - 1);
+    dst[w - 1] = src[0];
+  }
+}
+
+void JitterStage::shift_plane(int k, const PlaneView &src, bool half) {
+  const size_t w = (size_t)src.w;
+  std::vector<uint8_t> &buf = buf_[k];
+  buf.resize(w * (size_t)src.h);
+  parallel_rows(src.h, [&](int y0, int y1) {
+    for (int r = y0; r < y1; ++r) {
+      uint8_t *dst = buf.data() + (size_t)r * w;
+      if (horiz_) {
+        rotate_row(src.row(r), dst, src.w, forward_);
+        if (half)
+          avg8(dst, src.row(r), dst, w);
+      } else {
+        // 下移：第 r 行取自 r-1（环绕）；上移取自 r+1
+        const int from = forward_ ? (r + src.h - 1) % src.h : (r + 1) % src.h;
+        if (half)
+          avg8(src.row(from), src.row(r), dst, w);
+        else
+          std::memcpy(dst, src.row(from), w);
+      }
+    }
+  });
+}
+
+FrameView JitterStage::apply(size_t n, const FrameView &in) {
+  if (n % (size_t)period_ != 0)
+    return in;
+  FrameView out = in;
+  for (int k = 0; k < in.planes; ++k) {
+    const bool chroma = k > 0;
+    const bool half =
+        chroma && (horiz_ ? geo_.cw_shift > 0 : geo_.ch_shift > 0);
+    shift_plane(k, in.p[k], half);
+    out.p[k].data = buf_[k].data();
+    out.p[k].stride = (size_t)in.p[k].w;
+  }
+  return out;
+}
+
+std::string JitterStage::signature() const {
+  return "jitter:" + std::to_string(period_) + (horiz_ ? ":h" : ":v") +
+         (forward_ ? ":f" : ":b");
+}
+
+void FrameRing::push(const FrameView &f) {
+  if (slots_.empty())
+    return;
+  head_ = (head_ + 1) % slots_.size();
+  Slot &s = slots_[head_];
+  s.view = f;
+  for (int k = 0; k < f.planes; ++k) {
+    const PlaneView &p = f.p[k];
+    const size_t w = (size_t)p.w;
+    s.data[k].resize(w * (size_t)p.h);
+    for (int r = 0; r < p.h; ++r)
+      std::memcpy(s.data[k].data() + (size_t)r * w, p.row(r), w);
+    s.view.p[k].data = s.data[k].data();
+    s.view.p[k].stride = w;
+  }
+  count_ = std::min(count_ + 1, slots_.size());
+}
+
+FrameView FrameRing::at(size_t age) const {
+  if (age >= count_)
+    return FrameView();
+  return slots_[(head_ + slots_.size() - age) % slots_.size()].view;
+}
+
+// 混合一帧的全部平面：out[k] = blend8(a[k], b[k], w)
+static FrameView blend_frame(const FrameView &a, const FrameView &b, int w8,
+                             std::vector<uint8_t> (&buf)[3]) {
+  FrameView out = a;
+  for (int k = 0; k < a.planes; ++k) {
+    const PlaneView &pa = a.p[k], &pb = b.p[k];
+    const size_t w = (size_t)pa.w;
+    buf[k].resize(w * (size_t)pa.h);
+    parallel_rows(pa.h, [&](int y0, int y1) {
+      for (int r = y0; r < y1; ++r)
+        blend8(pa.row(r), pb.row(r), buf[k].data() + (size_t)r * w, w, w8);
+    });
+    out.p[k].data = buf[k].data();
+    out.p[k].stride = w;
+  }
+  return out;
+}
+
+// 不透明度 o 的 average 混合：cur + o*((cur+x)/2 - cur) = cur*(1-o/2) + x*o/2
+static int half_opacity_q8(double opacity) {
+  return (int)std::lround(std::clamp(opacity, 0.0, 1.0) * 128.0);
+}
+
+GhostStage::GhostStage(double opacity) : w8_(half_opacity_q8(opacity)) {}
+
+FrameView GhostStage::apply(size_t, const FrameView &in) {
+  const bool first = ring_.size() == 0;
+  FrameView out = first ? in : blend_frame(in, ring_.at(0), w8_, buf_);
+  ring_.push(in);
+  return out;
+}
+
+std::string GhostStage::signature() const {
+  return "ghost:" + std::to_string(w8_);
+}
+
+BleedStage::BleedStage(double sigma, double opacity,
+                       std::vector<std::pair<int, int>> spans)
+    : taps_(gauss_taps(sigma)), radius_((int)taps_.size() / 2),
+      w8_(half_opacity_q8(opacity)), spans_(std::move(spans)) {}
+
+// n 是否落在任一闭区间帧段内
+static bool in_spans(const std::vector<std::pair<int, int>> &spans, size_t n) {
+  for (auto &s : spans)
+    if ((long long)n >= s.first && (long long)n <= s.second)
+      return true;
+  return false;
+}
+
+static std::string spans_signature(const std::vector<std::pair<int, int>> &spans) {
+  std::string s;
+  for (auto &sp : spans)
+    s += "[" + std::to_string(sp.first) + "-" + std::to_string(sp.second) + "]";
+  return s;
+}
+
+FrameView BleedStage::apply(size_t n, const FrameView &in) {
+  if (!in_spans(spans_, n))
+    return in;
+  FrameView out = in;
+  for (int k = 0; k < in.planes; ++k) {
+    const PlaneView &p = in.p[k];
+    const size_t w = (size_t)p.w;
+    blur_.resize(w * (size_t)p.h);
+    buf_[k].resize(blur_.size());
+    // 条带：模糊结果在同一条带内立即被混合消费
+    parallel_rows(p.h, [&](int y0, int y1) {
+      blur8_separable(p.data, p.stride, blur_.data() + (size_t)y0 * w, w, p.w,
+                      p.h, taps_.data(), radius_, y0, y1);
+      for (int r = y0; r < y1; ++r)
+        blend8(p.row(r), blur_.data() + (size_t)r * w,
+               buf_[k].data() + (size_t)r * w, w, w8_);
+    });
+    out.p[k].data = buf_[k].data();
+    out.p[k].stride = w;
+  }
+  return out;
+}
+
+std::string BleedStage::signature() const {
+  std::string s = "bleed:" + std::to_string(w8_) + ":";
+  for (uint16_t t : taps_)
+    s += std::to_string(t) + ",";
+  return s + spans_signature(spans_);
+}
+
+ChromaBleedStage::ChromaBleedStage(const std::pair<int, int> (&shift)[2],
+                                   int radius,
+                                   std::vector<std::pair<int, int>> spans)
+    : shift_{shift[0], shift[1]}, radius_(std::clamp(radius, 0, 16)),
+      spans_(std::move(spans)) {}
+
+FrameView ChromaBleedStage::apply(size_t n, const FrameView &in) {
+  if (in.planes < 3 || !in_spans(spans_, n))
+    return in;
+  FrameView out = in;
+  for (int k = 1; k < 3; ++k) {
+    const PlaneView &p = in.p[k];
+    const size_t w = (size_t)p.w;
+    const int dx = shift_[k - 1].first, dy = shift_[k - 1].second;
+    // 平移：dst(x, y) = src(clamp(x - dx), clamp(y - dy))
+    tmp_.resize(w * (size_t)p.h);
+    parallel_rows(p.h, [&](int y0, int y1) {
+      for (int r = y0; r < y1; ++r) {
+        const uint8_t *s = p.row(std::clamp(r - dy, 0, p.h - 1));
+        uint8_t *d = tmp_.data() + (size_t)r * w;
+        const int lo = std::clamp(dx, 0, p.w),
+                  hi = std::clamp(p.w + dx, 0, p.w);
+        if (hi > lo)
+          std::memcpy(d + lo, s + (lo - dx), (size_t)(hi - lo));
+        std::memset(d, s[0], (size_t)lo);
+        std::memset(d + hi, s[p.w - 1], (size_t)(p.w - hi));
+      }
+    });
+    if (radius_ > 0) {
+      buf_[k - 1].resize(tmp_.size());
+      uint8_t *dst = buf_[k - 1].data();
+      parallel_rows(p.h, [&](int y0, int y1) {
+        box8_running(tmp_.data(), w, dst + (size_t)y0 * w, w, p.w, p.h,
+                     radius_, y0, y1);
+      });
+    } else {
+      buf_[k - 1].swap(tmp_);
+    }
+    out.p[k].data = buf_[k - 1].data();
+    out.p[k].stride = w;
+  }
+  return out;
+}
+
+std::string ChromaBleedStage::signature() const {
+  return "cbleed:" + std::to_string(shift_[0].first) + "," +
+         std::to_string(shift_[0].second) + "," +
+         std::to_string(shift_[1].first) + "," +
+         std::to_string(shift_[1].second) + ":" + std::to_string(radius_) +
+         ":" + spans_signature(spans_);
+}
+
+GrainStage::GrainStage(uint64_t seed, int strength)
+    : seed_(seed), strength_(std::clamp(strength, 0, 255)) {}
+
+// 每行的噪声流键：splitmix64 终混 (seed, 帧, 平面, 行)
+static uint32_t grain_key(uint64_t seed, size_t n, int k, int r) {
+  uint64_t z = seed + 0x9e3779b97f4a7c15ULL *
+                          (((uint64_t)n << 20 | (uint64_t)k << 18 | (uint64_t)r) + 1);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return (uint32_t)(z ^ (z >> 31));
+}
+
+FrameView GrainStage::apply(size_t n, const FrameView &in) {
+  FrameView out = in;
+  for (int k = 0; k < in.planes; ++k) {
+    const PlaneView &p = in.p[k];
+    const size_t w = (size_t)p.w;
+    buf_[k].resize(w * (size_t)p.h);
+    parallel_rows(p.h, [&](int y0, int y1) {
+      for (int r = y0; r < y1; ++r)
+        grain8(p.row(r), buf_[k].data() + (size_t)r * w, w,
+               grain_key(seed_, n, k, r), 0, strength_);
+    });
+    out.p[k].data = buf_[k].data();
+    out.p[k].stride = w;
+  }
+  return out;
+}
+
+std::string GrainStage::signature() const {
+  return "grain:" + std::to_string(seed_) + ":" + std::to_string(strength_);
+}
+
+const char *color_spec_name(const ColorSpec &c) {
+  static const char *names[3][2] = {{"bt601", "bt601-full"},
+                                    {"bt709", "bt709-full"},
+                                    {"bt2020", "bt2020-full"}};
+  return names[(int)c.matrix][c.full ? 1 : 0];
+}
+
+// RGB -> 归一化 YCbCr（Y ∈ [0,1]，Cb/Cr ∈ [-0.5,0.5]）
+static void ycc_from_rgb(ColorMatrix m, double a[3][3]) {
+  const double kr = m == ColorMatrix::Bt601   ? 0.299
+                    : m == ColorMatrix::Bt709 ? 0.2126
+                                              : 0.2627;
+  const double kb = m == ColorMatrix::Bt601   ? 0.114
+                    : m == ColorMatrix::Bt709 ? 0.0722
+                                              : 0.0593;
+  const double kg = 1.0 - kr - kb;
+  const double y[3] = {kr, kg, kb};
+  for (int j = 0; j < 3; ++j) {
+    a[0][j] = y[j];
+    a[1][j] = ((j == 2) - y[j]) / (2.0 * (1.0 - kb));
+    a[2][j] = ((j == 0) - y[j]) / (2.0 * (1.0 - kr));
+  }
+}
+
+static void invert3(const double a[3][3], double r[3][3]) {
+  const double det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+                     a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+                     a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) {
+      // 伴随矩阵转置：r[i][j] = cof(a)[j][i] / det
+      const int r0 = (j + 1) % 3, r1 = (j + 2) % 3;
+      const int c0 = (i + 1) % 3, c1 = (i + 2) % 3;
+      r[i][j] = (a[r0][c0] * a[r1][c1] - a[r0][c1] * a[r1][c0]) / det;
+    }
+}
+
+ColorMatrixStage::ColorMatrixStage(const FrameGeometry &g, ColorSpec src,
+                                   ColorSpec dst)
+    : geo_(g) {
+  double a[3][3], b[3][3], inv[3][3];
+  ycc_from_rgb(src.matrix, a);
+  ycc_from_rgb(dst.matrix, b);
+  invert3(a, inv);
+  // 码值 <-> 归一化：v = off + scale * n（色度 off 为 128）
+  const double ys_s = src.full ? 255.0 : 219.0, cs_s = src.full ? 255.0 : 224.0;
+  const double ys_d = dst.full ? 255.0 : 219.0, cs_d = dst.full ? 255.0 : 224.0;
+  const double yo_s = src.full ? 0.0 : 16.0, yo_d = dst.full ? 0.0 : 16.0;
+  const double in_scale[3] = {ys_s, cs_s, cs_s};
+  const double out_scale[3] = {ys_d, cs_d, cs_d};
+  const double out_off[3] = {yo_d, 128.0, 128.0};
+  for (int i = 0; i < 3; ++i) {
+    double c[3];
+    for (int j = 0; j < 3; ++j) {
+      double mij = 0;
+      for (int k = 0; k < 3; ++k)
+        mij += b[i][k] * inv[k][j];
+      c[j] = out_scale[i] * mij / in_scale[j];
+      // Q14 系数需放进 int16（|c| < 2；上述任意组合都满足）
+      m_[i][j] = (int16_t)std::clamp(std::lround(c[j] * 16384.0), -32768L,
+                                     32767L);
+    }
+    // 亮度输入按 y - yo_s 参与运算，其偏移并入常数项；+8192 为舍入
+    off_[i] = (int32_t)std::lround((out_off[i] - c[0] * yo_s) * 16384.0) + 8192;
+  }
+}
+
+FrameView ColorMatrixStage::apply(size_t, const FrameView &in) {
+  if (in.planes < 3)
+    return in;
+  FrameView out = in;
+  const PlaneView &y = in.p[0], &u = in.p[1], &v = in.p[2];
+  for (int k = 0; k < 3; ++k)
+    buf_[k].resize((size_t)in.p[k].w * (size_t)in.p[k].h);
+  parallel_rows(y.h, [&](int y0, int y1) {
+    for (int r = y0; r < y1; ++r) {
+      const int cr = r >> geo_.ch_shift;
+      ycc_row(y.row(r), u.row(cr), v.row(cr),
+              buf_[0].data() + (size_t)r * y.w, (size_t)y.w, geo_.cw_shift,
+              m_[0], off_[0]);
+    }
+  });
+  // 色度行的亮度系数为 0（灰色不变），y 参数只是占位，传 u
+  parallel_rows(u.h, [&](int y0, int y1) {
+    for (int k = 1; k < 3; ++k)
+      for (int r = y0; r < y1; ++r)
+        ycc_row(u.row(r), u.row(r), v.row(r),
+                buf_[k].data() + (size_t)r * u.w, (size_t)u.w, 0, m_[k],
+                off_[k]);
+  });
+  for (int k = 0; k < 3; ++k) {
+    out.p[k].data = buf_[k].data();
+    out.p[k].stride = (size_t)in.p[k].w;
+  }
+  return out;
+}
+
+std::string ColorMatrixStage::signature() const {
+  std::string s = "cmat:";
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j)
+      s += std::to_string(m_[i][j]) + ",";
+    s += std::to_string(off_[i]) + ";";
+  }
+  return s;
+}
+
+// 浮点系数量化到 Q8，余数并入中心，保证和为 256
+static std::vector<uint16_t> quantize_taps(const std::vector<double> &g) {
+  double sum = 0;
+  for (double v : g)
+    sum += v;
+  std::vector<uint16_t> t(g.size());
+  int q = 0;
+  for (size_t i = 0; i < g.size(); ++i)
+    q += t[i] = (uint16_t)std::lround(g[i] / sum * 256.0);
+  t[g.size() / 2] = (uint16_t)(t[g.size() / 2] + 256 - q);
+  return t;
+}
+
+std::vector<uint16_t> gauss_taps(double sigma) {
+  const int r = std::max(1, (int)std::ceil(3.0 * sigma));
+  std::vector<double> g(2 * r + 1);
+  for (int k = -r; k <= r; ++k)
+    g[k + r] = std::exp(-0.5 * k * k / (sigma * sigma));
+  return quantize_taps(g);
+}
+
+std::vector<uint16_t> box_taps(int size) {
+  return quantize_taps(std::vector<double>((size_t)(std::max(size, 1) | 1), 1.0));
+}
+
+SpatialOp gauss_op(double sigma) {
+  SpatialOp op;
+  if (sigma > 0)
+    op.taps = gauss_taps(sigma);
+  return op;
+}
+
+SpatialOp box_op(int size) {
+  SpatialOp op;
+  if (size > 1)
+    op.taps = box_taps(size);
+  return op;
+}
+
+SpatialOp unsharp_op(int size, double amount) {
+  SpatialOp op = box_op(size);
+  op.unsharp = true;
+  op.amount = (int)std::lround(amount * 256.0);
+  return op;
+}
+
+std::string SpatialOp::signature() const {
+  if (identity())
+    return "id";
+  std::string s = unsharp ? "us" + std::to_string(amount) + ":" : "blur:";
+  for (uint16_t t : taps)
+    s += std::to_string(t) + ",";
+  return s;
+}
+
+SpatialStage::SpatialStage(SpatialOp luma, SpatialOp chroma)
+    : op_{std::move(luma), std::move(chroma)} {}
+
+FrameView SpatialStage::apply(size_t, const FrameView &in) {
+  constexpr int kStrip = 32;
+  FrameView out = in;
+  for (int k = 0; k < in.planes; ++k) {
+    const SpatialOp &op = op_[k > 0];
+    if (op.identity())
+      continue;
+    const PlaneView &p = in.p[k];
+    const size_t w = (size_t)p.w;
+    const int radius = (int)op.taps.size() / 2;
+    buf_[k].resize(w * (size_t)p.h);
+    uint8_t *dst = buf_[k].data();
+    if (!op.unsharp) {
+      parallel_rows(p.h, [&](int y0, int y1) {
+        blur8_separable(p.data, p.stride, dst + (size_t)y0 * w, w, p.w, p.h,
+                        op.taps.data(), radius, y0, y1);
+      });
+    } else {
+      // 每个并行条带再按 kStrip 行分段，模糊缓冲只有 kStrip 行
+      parallel_rows(
+          p.h,
+          [&](int s0, int s1) {
+            std::vector<uint8_t> strip(w * kStrip);
+            for (int y0 = s0; y0 < s1; y0 += kStrip) {
+              const int y1 = std::min(y0 + kStrip, s1);
+              blur8_separable(p.data, p.stride, strip.data(), w, p.w, p.h,
+                              op.taps.data(), radius, y0, y1);
+              for (int r = y0; r < y1; ++r)
+                unsharp8(p.row(r), strip.data() + (size_t)(r - y0) * w,
+                         dst + (size_t)r * w, w, op.amount);
+            }
+          },
+          kStrip);
+    }
+    out.p[k].data = buf_[k].data();
+    out.p[k].stride = w;
+  }
+  return out;
+}
+
+std::string SpatialStage::signature() const {
+  return "spatial:" + op_[0].signature() + "|" + op_[1].signature();
+}
+
+FrameView ChainStage::apply(size_t n, const FrameView &in) {
+  FrameView f = in;
+  for (auto &s : stages_)
+    f = s->apply(n, f);
+  return f;
+}
+
+bool ChainStage::temporal() const {
+  for (auto &s : stages_)
+    if (s->temporal())
+      return true;
+  return false;
+}
+
+std::shared_ptr<NativeStage> ChainStage::clone() const {
+  std::vector<std::shared_ptr<NativeStage>> v;
+  for (auto &s : stages_)
+    v.push_back(s->clone());
+  return std::make_shared<ChainStage>(std::move(v));
+}
+
+std::string ChainStage::signature() const {
+  std::string s = "chain(";
+  for (auto &st : stages_)
+    s += st->signature() + ";";
+  return s + ")";
+}
+
+bool write_frame(Proc &out, const FrameView &f) {
+  for (int k = 0; k < f.planes; ++k) {
+    const PlaneView &p = f.p[k];
+    if (p.stride == (size_t)p.w) {
+      if (!out.write_all(p.data, (size_t)p.w * (size_t)p.h))
+        return false;
+      continue;
+    }
+    for (int r = 0; r < p.h; ++r)
+      if (!out.write_all(p.row(r), (size_t)p.w))
+        return false;
+  }
+  return true;
+}
@@ -0,0 +1,233 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "FrameSource.hpp"
+#include "Process.hpp"
+
+// 原生（进程内）处理阶段：输入一帧视图，返回输出视图。
+// 输出可直接引用输入平面（零拷贝透传），或指向阶段自带的缓冲；
+// 返回的视图在下一次 apply 前有效。
+// 帧内并行：各阶段按行条带经共享线程池（Pool.hpp）执行；
+// 非时域阶段还可由流水线（Pipeline.hpp）用多个副本并发处理不同帧
+class NativeStage {
+public:
+    virtual ~NativeStage() = default;
+    virtual FrameView apply(size_t n, const FrameView& in) = 0;
+    // 参数的完整描述（参与结果缓存键）
+    virtual std::string signature() const = 0;
+    // 输出依赖前序帧（须按帧序逐帧调用同一实例）
+    virtual bool temporal() const { return false; }
+    // 参数相同、缓冲独立的副本
+    virtual std::shared_ptr<NativeStage> clone() const = 0;
+};
+
+// Y 平面 256 项查表（brightness / highclip / banding），U/V 透传
+class LutStage : public NativeStage {
+public:
+    explicit LutStage(const uint8_t (&lut)[256]);
+    FrameView apply(size_t n, const FrameView& in) override;
+    std::string signature() const override;
+    std::shared_ptr<NativeStage> clone() const override {
+        return std::make_shared<LutStage>(*this);
+    }
+
+private:
+    uint8_t lut_[256];
+    std::vector<uint8_t> y_;
+};
+
+// 1px 环绕平移（jitter）：仅在 n % period == 0 的帧上，其余帧零拷贝透传。
+// 亮度平移整 1 像素；在该方向上下采样的色度平面平移半个样本（相邻两样本取平均），
+// 与 4:4:4 下平移 1px 再降采样的效果一致，无需格式往返
+class JitterStage : public NativeStage {
+public:
+    JitterStage(const FrameGeometry& g, int period, bool horiz, bool forward);
+    FrameView apply(size_t n, const FrameView& in) override;
+    std::string signature() const override;
+    std::shared_ptr<NativeStage> clone() const override {
+        return std::make_shared<JitterStage>(*this);
+    }
+
+private:
+    void shift_plane(int k, const PlaneView& src, bool half);
+    FrameGeometry geo_;
+    int period_;
+    bool horiz_, forward_;
+    std::vector<uint8_t> buf_[3];
+};
+
+// 最近 depth 帧的拷贝（时域阶段用）：输入视图不保证在下一帧时仍有效，故复制保存。
+// 槽位循环复用，稳定后不再分配；at(0) 为最近 push 的帧
+class FrameRing {
+public:
+    explicit FrameRing(size_t depth) : slots_(depth) {}
+    void push(const FrameView& f);
+    size_t size() const { return count_; }
+    FrameView at(size_t age) const; // age < size()
+
+private:
+    struct Slot {
+        FrameView view;
+        std::vector<uint8_t> data[3];
+    };
+    std::vector<Slot> slots_;
+    size_t head_=0, count_=0;
+};
+
+// 时域残影（对应 tblend average + opacity）：out = cur + o*(prev-cur)/2，
+// 即与上一输入帧按 Q8 权重 o/2 混合，所有平面；首帧原样输出。ffmpeg 路径同样
+// 把首帧原样接在 tblend 输出之前，两条路径帧数与对齐一致
+class GhostStage : public NativeStage {
+public:
+    explicit GhostStage(double opacity);
+    FrameView apply(size_t n, const FrameView& in) override;
+    std::string signature() const override;
+    bool temporal() const override { return true; }
+    std::shared_ptr<NativeStage> clone() const override {
+        return std::make_shared<GhostStage>(*this);
+    }
+
+private:
+    int w8_;
+    FrameRing ring_{1};
+    std::vector<uint8_t> buf_[3];
+};
+
+// 亮度拖影（对应 split + gblur + blend average，按帧段启用）：段内帧与自身的
+// 高斯模糊按 Q8 权重 o/2 混合，所有平面；段外帧零拷贝透传，不做模糊
+class BleedStage : public NativeStage {
+public:
+    BleedStage(double sigma, double opacity, std::vector<std::pair<int,int>> spans);
+    FrameView apply(size_t n, const FrameView& in) override;
+    std::string signature() const override;
+    std::shared_ptr<NativeStage> clone() const override {
+        return std::make_shared<BleedStage>(*this);
+    }
+
+private:
+    std::vector<uint16_t> taps_;
+    int radius_;
+    int w8_;
+    std::vector<std::pair<int,int>> spans_;
+    std::vector<uint8_t> blur_, buf_[3];
+};
+
+// 色度拖影（对应 chromashift + boxblur 色度半径，按帧段启用）：段内帧的 U/V 各自平移
+// （单位为该平面的样本，边缘复制，同 chromashift 的 smear），radius>0 时再做
+// running-sum 方框模糊（chroma 缺陷沿用 boxblur=0:2 的效果，取 0）。
+// Y 平面与段外帧零拷贝透传；4:2:0 下只处理约 1/3 的数据
+class ChromaBleedStage : public NativeStage {
+public:
+    // shift[0] = Cb (h, v)，shift[1] = Cr (h, v)；正值向右/向下
+    ChromaBleedStage(const std::pair<int,int> (&shift)[2], int radius,
+                     std::vector<std::pair<int,int>> spans);
+    FrameView apply(size_t n, const FrameView& in) override;
+    std::string signature() const override;
+    std::shared_ptr<NativeStage> clone() const override {
+        return std::make_shared<ChromaBleedStage>(*this);
+    }
+
+private:
+    std::pair<int,int> shift_[2];
+    int radius_;
+    std::vector<std::pair<int,int>> spans_;
+    std::vector<uint8_t> tmp_, buf_[2];
+};
+
+// 胶片颗粒（对应 noise=alls=s:allf=t+u）：每个样本加 [-s/2, s/2) 的均匀噪声，所有平面。
+// 噪声由计数器哈希按 (seed, 帧号, 平面, 行, 列) 直接算出，不依赖前序状态：
+// 任意帧、任意行可独立生成，结果与机器、ffmpeg 版本无关
+class GrainStage : public NativeStage {
+public:
+    GrainStage(uint64_t seed, int strength);
+    FrameView apply(size_t n, const FrameView& in) override;
+    std::string signature() const override;
+    std::shared_ptr<NativeStage> clone() const override {
+        return std::make_shared<GrainStage>(*this);
+    }
+
+private:
+    uint64_t seed_;
+    int strength_;
+    std::vector<uint8_t> buf_[3];
+};
+
+// YCbCr 色彩描述：矩阵系数 + 量化范围（limited: Y 16..235 / C 16..240；full: 0..255）
+enum class ColorMatrix { Bt601, Bt709, Bt2020 };
+struct ColorSpec {
+    ColorMatrix matrix=ColorMatrix::Bt709;
+    bool full=false;
+};
+const char* color_spec_name(const ColorSpec& c); // 如 "bt709" / "bt2020-full"
+
+// 色彩矩阵换算（对应 colormatrix / 范围错配）：按 src 解码为 RGB 再按 dst 编码，合成一个
+// Q14 的 3x3 矩阵。灰色在任意两种矩阵间都映射为灰色，故色度输出只依赖同位置的 U/V；
+// 亮度输出取其所在下采样块的色度样本（与 colormatrix 对 4:2:0 的处理一致）。gray 透传
+class ColorMatrixStage : public NativeStage {
+public:
+    ColorMatrixStage(const FrameGeometry& g, ColorSpec src, ColorSpec dst);
+    FrameView apply(size_t n, const FrameView& in) override;
+    std::string signature() const override;
+    std::shared_ptr<NativeStage> clone() const override {
+        return std::make_shared<ColorMatrixStage>(*this);
+    }
+
+private:
+    FrameGeometry geo_;
+    int16_t m_[3][3];
+    int32_t off_[3];
+    std::vector<uint8_t> buf_[3];
+};
+
+// Q8 可分离系数（和为 256，量化余数并入中心）：高斯取 radius=max(1,ceil(3σ))，
+// 方框为 size 点均值（size 取奇数，对应 unsharp 的 lx/ly）
+std::vector<uint16_t> gauss_taps(double sigma);
+std::vector<uint16_t> box_taps(int size);
+
+// 单平面空间算子：纯模糊，或反锐化掩模 src + amount*(src - blur)（amount 为 Q8）
+struct SpatialOp {
+    std::vector<uint16_t> taps; // 空表示透传
+    bool unsharp=false;
+    int amount=0;
+    bool identity() const { return taps.empty() || (unsharp && amount == 0); }
+    std::string signature() const;
+};
+SpatialOp gauss_op(double sigma);
+SpatialOp box_op(int size);
+SpatialOp unsharp_op(int size, double amount); // 对应 unsharp=lx=size:ly=size:la=amount
+
+// 空间滤波（gblur / unsharp）：Y 用 luma 算子，U/V 用 chroma 算子。
+// 反锐化按 32 行条带进行：条带模糊结果留在 L2 中即被消费，不产生整帧中间缓冲
+class SpatialStage : public NativeStage {
+public:
+    SpatialStage(SpatialOp luma, SpatialOp chroma);
+    FrameView apply(size_t n, const FrameView& in) override;
+    std::string signature() const override;
+    std::shared_ptr<NativeStage> clone() const override {
+        return std::make_shared<SpatialStage>(*this);
+    }
+
+private:
+    SpatialOp op_[2];
+    std::vector<uint8_t> buf_[3];
+};
+
+// 依次执行多个阶段；前一阶段的输出视图直接作为下一阶段输入，不额外复制
+class ChainStage : public NativeStage {
+public:
+    explicit ChainStage(std::vector<std::shared_ptr<NativeStage>> stages)
+        : stages_(std::move(stages)) {}
+    FrameView apply(size_t n, const FrameView& in) override;
+    std::string signature() const override;
+    bool temporal() const override;
+    std::shared_ptr<NativeStage> clone() const override;
+
+private:
+    std::vector<std::shared_ptr<NativeStage>> stages_;
+};
+
+// 按平面顺序写出一帧 rawvideo；失败（如编码器已退出）返回 false
+bool write_frame(Proc& out, const FrameView& f);
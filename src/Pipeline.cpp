@@ -0,0 +1,346 @@
+#include "Pipeline.hpp"
+#include "Native.hpp"
+#include "Pool.hpp"
+#include "Telemetry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// 每个处理线程的输入队列深度（只是视图；对应页面已由读取线程调入页缓存）
+constexpr size_t kReadDepth = 4;
+// 每个处理线程的输出槽位：一个在填，一个等待写出
+constexpr size_t kSlots = 2;
+// 无处理阶段时读取 → 写出的队列深度
+constexpr size_t kDirectDepth = 16;
+
+uint64_t now_ns() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Counters {
+  std::atomic<uint64_t> push_stall_ns{0}, pop_stall_ns{0};
+  std::atomic<uint64_t> depth_sum{0}, pops{0};
+  std::atomic<size_t> max_depth{0};
+
+  // 消费者取出元素时的队列深度（含取出的这个）
+  void popped(size_t depth) {
+    depth_sum.fetch_add(depth, std::memory_order_relaxed);
+    pops.fetch_add(1, std::memory_order_relaxed);
+    size_t m = max_depth.load(std::memory_order_relaxed);
+    while (depth > m && !max_depth.compare_exchange_weak(m, depth))
+      ;
+  }
+
+  QueueStats stats(const char *name, size_t cap) const {
+    QueueStats q;
+    q.name = name;
+    q.capacity = cap;
+    const uint64_t n = pops.load();
+    q.mean_depth = n ? (double)depth_sum.load() / (double)n : 0;
+    q.max_depth = max_depth.load();
+    q.push_stall_s = (double)push_stall_ns.load() * 1e-9;
+    q.pop_stall_s = (double)pop_stall_ns.load() * 1e-9;
+    return q;
+  }
+};
+
+// 等待 ready() 成立：先自旋，再让出，最后短睡；stop 置位时放弃。等待时长计入 stall
+template <class F>
+bool wait_for(F ready, const std::atomic<bool> &stop,
+              std::atomic<uint64_t> &stall) {
+  if (ready())
+    return true;
+  const uint64_t t0 = now_ns();
+  bool ok = false;
+  for (int spin = 0;; ++spin) {
+    if (ready()) {
+      ok = true;
+      break;
+    }
+    if (stop.load(std::memory_order_relaxed))
+      break;
+    if (spin >= 256)
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    else if (spin >= 32)
+      std::this_thread::yield();
+  }
+  stall.fetch_add(now_ns() - t0, std::memory_order_relaxed);
+  return ok;
+}
+
+struct Slot {
+  std::vector<uint8_t> data;
+};
+
+struct Job {
+  size_t n = 0;
+  FrameView f; // 空视图表示输入结束
+};
+
+struct Done {
+  size_t n = 0;
+  FrameView f;
+  Slot *slot = nullptr; // 占用的槽位，全部平面透传时为空
+  int worker = -1;
+};
+
+// 逐页读一个字节，让映射页面的缺页发生在读取线程而不是处理线程上
+unsigned prefetch(const FrameView &f) {
+  unsigned s = 0;
+  for (int k = 0; k < f.planes; ++k) {
+    const PlaneView &p = f.p[k];
+    if (!p.data || p.w <= 0 || p.h <= 0)
+      continue;
+    const size_t bytes = p.stride * (size_t)(p.h - 1) + (size_t)p.w;
+    for (size_t o = 0; o < bytes; o += 4096)
+      s += p.data[o];
+    s += p.data[bytes - 1];
+  }
+  return s;
+}
+
+// 阶段输出中指向输入平面的部分（内存映射，整个运行期间有效）原样引用，
+// 其余平面（阶段自带缓冲，下一次 apply 即被覆盖）拷进槽位
+bool owns_planes(const FrameView &in, const FrameView &out) {
+  for (int k = 0; k < out.planes; ++k)
+    if (k >= in.planes || out.p[k].data != in.p[k].data)
+      return true;
+  return false;
+}
+
+FrameView copy_into(Slot &s, const FrameView &in, const FrameView &out) {
+  size_t bytes = 0;
+  for (int k = 0; k < out.planes; ++k)
+    if (k >= in.planes || out.p[k].data != in.p[k].data)
+      bytes += (size_t)out.p[k].w * (size_t)out.p[k].h;
+  if (s.data.size() < bytes)
+    s.data.resize(bytes);
+  FrameView v = out;
+  uint8_t *dst = s.data.data();
+  for (int k = 0; k < out.planes; ++k) {
+    const PlaneView &p = out.p[k];
+    if (k < in.planes && p.data == in.p[k].data)
+      continue;
+    for (int y = 0; y < p.h; ++y)
+      std::copy_n(p.row(y), (size_t)p.w, dst + (size_t)y * (size_t)p.w);
+    v.p[k].data = dst;
+    v.p[k].stride = (size_t)p.w;
+    dst += (size_t)p.w * (size_t)p.h;
+  }
+  return v;
+}
+
+// 本线程自 cpu0 起的 CPU 时间，加上 extra（其在线程池上派生任务的时间）
+void add_thread_cpu(ParallelScope &scope, double cpu0, double extra = 0) {
+  scope.add_cpu_ns(
+      (uint64_t)std::max(0.0, (thread_cpu_s() - cpu0 + extra) * 1e9));
+}
+
+} // namespace
+
+bool run_pipeline(size_t count, const std::function<FrameView(size_t)> &read,
+                  const std::vector<std::shared_ptr<NativeStage>> &stages,
+                  const std::function<bool(const FrameView &)> &write,
+                  ParallelScope &scope, PipelineStats &st) {
+  st = PipelineStats{};
+  if (count == 0)
+    return true;
+  const int W = (int)stages.size();
+  const uint64_t t_start = now_ns();
+  std::atomic<bool> stop{false}, failed{false};
+  std::atomic<uint64_t> read_busy{0}, work_busy{0};
+  Counters read_c, slot_c, out_c;
+
+  // 读取 → 处理：每个处理线程一条 SPSC 队列，帧 n 固定交给 n % W 号线程
+  std::vector<std::unique_ptr<SpscQueue<Job>>> in;
+  // 写出 → 处理：各线程自己的空闲槽位（只在自己的帧之间复用，不会互相等待）
+  std::vector<std::unique_ptr<SpscQueue<Slot *>>> free_slots;
+  std::vector<Slot> slots((size_t)W * kSlots);
+  for (int w = 0; w < W; ++w) {
+    in.push_back(std::make_unique<SpscQueue<Job>>(kReadDepth));
+    free_slots.push_back(std::make_unique<SpscQueue<Slot *>>(kSlots));
+    for (size_t k = 0; k < kSlots; ++k) {
+      Slot *s = &slots[(size_t)w * kSlots + k];
+      free_slots.back()->try_push(s);
+    }
+  }
+  // 处理 → 写出：乱序到达，写出线程按帧号重排
+  MpscQueue<Done> done((size_t)std::max(W, 1) * (kSlots + 2));
+  // 无处理阶段：读取线程直接按帧序交给写出线程
+  SpscQueue<Done> direct(kDirectDepth);
+
+  std::thread reader([&] {
+    const double cpu0 = thread_cpu_s();
+    volatile unsigned touched = 0;
+    for (size_t i = 0; i < count && !stop.load(); ++i) {
+      const uint64_t t0 = now_ns();
+      FrameView f = read(i);
+      if (!f) {
+        failed = true;
+        stop = true;
+        break;
+      }
+      touched = touched + prefetch(f);
+      read_busy.fetch_add(now_ns() - t0, std::memory_order_relaxed);
+      if (W == 0) {
+        Done d{i, f, nullptr, -1};
+        if (!wait_for([&] { return direct.try_push(d); }, stop,
+                      read_c.push_stall_ns))
+          break;
+        continue;
+      }
+      Job j{i, f};
+      SpscQueue<Job> &q = *in[i % (size_t)W];
+      if (!wait_for([&] { return q.try_push(j); }, stop, read_c.push_stall_ns))
+        break;
+    }
+    for (int w = 0; w < W; ++w) {
+      Job end;
+      if (!wait_for([&] { return in[(size_t)w]->try_push(end); }, stop,
+                    read_c.push_stall_ns))
+        break;
+    }
+    add_thread_cpu(scope, cpu0);
+  });
+
+  // 帧间已由多个线程并行，各线程内的行条带并行只分到预算的一份
+  const int sub_width = std::max(1, scope.width() / std::max(W, 1));
+  std::vector<std::thread> workers;
+  for (int w = 0; w < W; ++w) {
+    workers.emplace_back([&, w] {
+      const double cpu0 = thread_cpu_s();
+      ParallelScope ws(sub_width);
+      SpscQueue<Job> &q = *in[(size_t)w];
+      SpscQueue<Slot *> &fs = *free_slots[(size_t)w];
+      for (;;) {
+        Job j;
+        if (!wait_for(
+                [&] {
+                  const size_t d = q.size();
+                  if (!q.try_pop(j))
+                    return false;
+                  read_c.popped(d);
+                  return true;
+                },
+                stop, read_c.pop_stall_ns) ||
+            !j.f)
+          break;
+        const uint64_t t0 = now_ns();
+        const FrameView out = stages[(size_t)w]->apply(j.n, j.f);
+        Done d{j.n, out, nullptr, w};
+        uint64_t busy = now_ns() - t0;
+        if (owns_planes(j.f, out)) {
+          if (!wait_for(
+                  [&] {
+                    const size_t n = fs.size();
+                    if (!fs.try_pop(d.slot))
+                      return false;
+                    slot_c.popped(n);
+                    return true;
+                  },
+                  stop, slot_c.pop_stall_ns))
+            break;
+          const uint64_t t1 = now_ns();
+          d.f = copy_into(*d.slot, j.f, out);
+          busy += now_ns() - t1;
+        }
+        work_busy.fetch_add(busy, std::memory_order_relaxed);
+        if (!wait_for([&] { return done.try_push(d); }, stop,
+                      out_c.push_stall_ns))
+          break;
+      }
+      add_thread_cpu(scope, cpu0, ws.cpu_s());
+    });
+  }
+
+  // 写出（调用线程）：按帧序取结果写入编码器，写完归还槽位
+  std::map<size_t, Done> pending;
+  uint64_t write_busy = 0;
+  bool ok = true;
+  for (size_t next = 0; ok && next < count; ++next) {
+    Done d;
+    if (W == 0) {
+      ok = wait_for(
+          [&] {
+            const size_t n = direct.size();
+            if (!direct.try_pop(d))
+              return false;
+            read_c.popped(n);
+            return true;
+          },
+          stop, read_c.pop_stall_ns);
+    } else {
+      auto it = pending.find(next);
+      while (ok && it == pending.end()) {
+        Done x;
+        ok = wait_for(
+            [&] {
+              const size_t n = done.size();
+              if (!done.try_pop(x))
+                return false;
+              out_c.popped(n);
+              return true;
+            },
+            stop, out_c.pop_stall_ns);
+        if (ok && pending.emplace(x.n, x).first->first == next)
+          it = pending.find(next);
+      }
+      if (ok) {
+        d = it->second;
+        pending.erase(it);
+      }
+    }
+    if (!ok)
+      break;
+    const uint64_t t0 = now_ns();
+    ok = write(d.f);
+    write_busy += now_ns() - t0;
+    if (d.slot)
+      free_slots[(size_t)d.worker]->try_push(d.slot);
+  }
+  stop = true;
+  reader.join();
+  for (auto &t : workers)
+    t.join();
+
+  st.workers = W;
+  st.wall_s = (double)(now_ns() - t_start) * 1e-9;
+  st.read_busy_s = (double)read_busy.load() * 1e-9;
+  st.work_busy_s = (double)work_busy.load() * 1e-9;
+  st.write_busy_s = (double)write_busy * 1e-9;
+  if (W == 0) {
+    st.queues.push_back(read_c.stats("read", direct.capacity()));
+  } else {
+    st.queues.push_back(read_c.stats("read", (size_t)W * in[0]->capacity()));
+    st.queues.push_back(slot_c.stats("slots", (size_t)W * kSlots));
+    st.queues.push_back(out_c.stats("write", done.capacity()));
+  }
+  // 瓶颈：忙碌比例最高的一级（处理线程按线程数折算）
+  const double wall = std::max(st.wall_s, 1e-9);
+  const double u_read = st.read_busy_s / wall;
+  const double u_work = W ? st.work_busy_s / (wall * W) : 0;
+  const double u_write = st.write_busy_s / wall;
+  st.bound = u_work >= u_read && u_work >= u_write ? "cpu"
+             : u_read >= u_write                 ? "io"
+                                                 : "encoder";
+  return ok && !failed.load();
+}
+
+std::string pipeline_summary(const PipelineStats &st) {
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(2) << "bound=" << st.bound
+     << " workers=" << st.workers << " busy=" << st.read_busy_s << "/"
+     << st.work_busy_s << "/" << st.write_busy_s << "s";
+  for (const QueueStats &q : st.queues)
+    ss << " " << q.name << "[q " << std::setprecision(1) << q.mean_depth << "/"
+       << q.capacity << " stall " << std::setprecision(2) << q.push_stall_s
+       << "/" << q.pop_stall_s << "s]";
+  return ss.str();
+}
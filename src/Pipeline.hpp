@@ -0,0 +1,139 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "FrameSource.hpp"
+
+class NativeStage;
+class ParallelScope;
+
+// 原生路径的逐帧流水线：读取线程（预取）→ 处理线程 → 写出线程（编码器管道）。
+// 各级之间是有界无锁队列，驻留内存只取决于队列/槽位数，与片段长度无关。
+// 每个队列统计深度与两端的阻塞时间，用来判断一次运行受限于 I/O、CPU 还是编码器
+
+// 有界单生产者/单消费者环形队列（无锁）；容量向上取 2 的幂
+template <class T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t cap) {
+        size_t n = 1;
+        while (n < cap) n <<= 1;
+        buf_.resize(n);
+        mask_ = n - 1;
+    }
+    size_t capacity() const { return mask_ + 1; }
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool try_push(T& v) {
+        const size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - head_.load(std::memory_order_acquire) > mask_) return false;
+        buf_[t & mask_] = std::move(v);
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    bool try_pop(T& v) {
+        const size_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_.load(std::memory_order_acquire)) return false;
+        v = std::move(buf_[h & mask_]);
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> buf_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0}; // 消费者
+    alignas(64) std::atomic<size_t> tail_{0}; // 生产者
+};
+
+// 有界多生产者/单消费者队列（Vyukov 序号槽，无锁）；容量向上取 2 的幂
+template <class T>
+class MpscQueue {
+public:
+    explicit MpscQueue(size_t cap) {
+        size_t n = 1;
+        while (n < cap) n <<= 1;
+        cells_.reset(new Cell[n]);
+        for (size_t i = 0; i < n; ++i) cells_[i].seq.store(i, std::memory_order_relaxed);
+        mask_ = n - 1;
+    }
+    size_t capacity() const { return mask_ + 1; }
+    // 仅消费者调用
+    size_t size() const { return tail_.load(std::memory_order_acquire) - head_; }
+    bool try_push(T& v) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Cell* c;
+        for (;;) {
+            c = &cells_[pos & mask_];
+            const size_t seq = c->seq.load(std::memory_order_acquire);
+            const intptr_t d = (intptr_t)seq - (intptr_t)pos;
+            if (d == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (d < 0) {
+                return false; // 满
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        c->v = std::move(v);
+        c->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    bool try_pop(T& v) {
+        Cell& c = cells_[head_ & mask_];
+        if (c.seq.load(std::memory_order_acquire) != head_ + 1) return false;
+        v = std::move(c.v);
+        c.seq.store(head_ + mask_ + 1, std::memory_order_release);
+        ++head_;
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T v;
+    };
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> tail_{0}; // 生产者共享
+    alignas(64) size_t head_ = 0;             // 消费者独占
+};
+
+// 一级队列的统计（同一级的多个队列合并计数）
+struct QueueStats {
+    std::string name;
+    size_t capacity = 0;   // 该级所有队列容量之和
+    double mean_depth = 0; // 消费者取元素时的平均深度
+    size_t max_depth = 0;
+    double push_stall_s = 0; // 生产者因队列满而等待
+    double pop_stall_s = 0;  // 消费者因队列空而等待
+};
+
+struct PipelineStats {
+    int workers = 0;
+    double read_busy_s = 0;  // 取帧 + 预取页面
+    double work_busy_s = 0;  // 各处理线程 apply + 拷贝之和
+    double write_busy_s = 0; // 写入编码器管道（管道满时阻塞在此）
+    double wall_s = 0;
+    std::vector<QueueStats> queues;
+    std::string bound; // "io" / "cpu" / "encoder"：忙碌比例最高的一级
+    bool empty() const { return bound.empty(); }
+};
+
+// 运行流水线，输出 count 帧。read(i) 返回第 i 个输出帧的输入视图，须在整个运行期间有效
+// （如内存映射的帧源）；stages 为各处理线程独占的阶段实例，空则读取线程直接交给写出。
+// 时域阶段只能传一个实例。write 在调用线程上按帧序执行，返回 false 时中止。
+// 处理线程与读取线程的 CPU 时间（含其在线程池上派生的任务）记入 scope
+bool run_pipeline(size_t count, const std::function<FrameView(size_t)>& read,
+                  const std::vector<std::shared_ptr<NativeStage>>& stages,
+                  const std::function<bool(const FrameView&)>& write,
+                  ParallelScope& scope, PipelineStats& st);
+
+// 一行摘要（manifest.txt）：bound=cpu workers=4 read[q 3.1/32 stall 0.00/0.12s] ...
+std::string pipeline_summary(const PipelineStats& st);
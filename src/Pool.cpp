@@ -0,0 +1,199 @@
+#include "Pool.hpp"
+#include "Sched.hpp"
+#include "Telemetry.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Batch {
+  const std::function<void(size_t)> *fn = nullptr;
+  size_t n = 0;
+  std::atomic<size_t> next{0}, done{0};
+  ParallelScope *scope = nullptr;
+  std::mutex mu;
+  std::condition_variable cv;
+
+  // 领取并执行剩余下标；令牌可能在批次完成后才被取到，此时直接返回
+  void run() {
+    for (size_t i; (i = next.fetch_add(1)) < n;) {
+      (*fn)(i);
+      if (done.fetch_add(1) + 1 == n) {
+        std::lock_guard<std::mutex> lk(mu);
+        cv.notify_all();
+      }
+    }
+  }
+};
+
+thread_local ParallelScope *tl_scope = nullptr;
+thread_local int tl_worker = -1; // 工作线程下标，-1 为池外线程
+thread_local int tl_depth = 0;   // 工作线程上正在执行的令牌层数
+
+class Pool {
+public:
+  Pool() : queues_((size_t)std::max(0, available_cpus() - 1)) {
+    for (size_t i = 0; i < queues_.size(); ++i)
+      threads_.emplace_back([this, i] { loop((int)i); });
+  }
+  ~Pool() {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto &t : threads_)
+      t.join();
+  }
+
+  int width() const { return (int)queues_.size() + 1; }
+
+  void push(const std::shared_ptr<Batch> &b, size_t tokens) {
+    if (queues_.empty())
+      return;
+    for (size_t t = 0; t < tokens; ++t) {
+      // 工作线程上的嵌套批次放回自己的队尾（LIFO，缓存仍热）；池外线程轮流分发
+      const size_t q = tl_worker >= 0
+                           ? (size_t)tl_worker
+                           : rr_.fetch_add(1) % queues_.size();
+      std::lock_guard<std::mutex> lk(queues_[q].mu);
+      queues_[q].d.push_back(b);
+    }
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      queued_ += tokens;
+    }
+    if (tokens == 1)
+      cv_.notify_one();
+    else
+      cv_.notify_all();
+  }
+
+private:
+  struct Queue {
+    std::mutex mu;
+    std::deque<std::shared_ptr<Batch>> d;
+  };
+
+  std::shared_ptr<Batch> take(int self) {
+    {
+      Queue &q = queues_[(size_t)self];
+      std::lock_guard<std::mutex> lk(q.mu);
+      if (!q.d.empty()) {
+        auto b = std::move(q.d.back());
+        q.d.pop_back();
+        return b;
+      }
+    }
+    for (size_t k = 1; k < queues_.size(); ++k) {
+      Queue &q = queues_[((size_t)self + k) % queues_.size()];
+      std::lock_guard<std::mutex> lk(q.mu);
+      if (!q.d.empty()) {
+        auto b = std::move(q.d.front());
+        q.d.pop_front();
+        return b;
+      }
+    }
+    return nullptr;
+  }
+
+  void loop(int self) {
+    tl_worker = self;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lk(mu_);
+        cv_.wait(lk, [&] { return stop_ || queued_ > 0; });
+        if (stop_)
+          return;
+      }
+      std::shared_ptr<Batch> b = take(self);
+      if (!b) {
+        std::this_thread::yield();
+        continue;
+      }
+      {
+        std::lock_guard<std::mutex> lk(mu_);
+        --queued_;
+      }
+      execute(*b);
+    }
+  }
+
+  // 代为执行的 CPU 时间记入批次所属作用域；嵌套令牌已计入外层，不重复累计
+  static void execute(Batch &b) {
+    ParallelScope *saved = tl_scope;
+    tl_scope = b.scope;
+    const double c0 = tl_depth == 0 ? thread_cpu_s() : 0;
+    ++tl_depth;
+    b.run();
+    --tl_depth;
+    if (tl_depth == 0 && b.scope)
+      b.scope->add_cpu_ns((uint64_t)std::max(0.0, (thread_cpu_s() - c0) * 1e9));
+    tl_scope = saved;
+  }
+
+  std::vector<Queue> queues_;
+  std::vector<std::thread> threads_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  size_t queued_ = 0;
+  bool stop_ = false;
+  std::atomic<size_t> rr_{0};
+};
+
+Pool &pool() {
+  static Pool p;
+  return p;
+}
+
+} // namespace
+
+ParallelScope::ParallelScope(int width)
+    : width_(width > 0 ? width : pool().width()), prev_(tl_scope) {
+  tl_scope = this;
+}
+
+ParallelScope::~ParallelScope() { tl_scope = prev_; }
+
+int parallel_width() {
+  const int w = pool().width();
+  return tl_scope ? std::min(tl_scope->width(), w) : w;
+}
+
+void parallel_for(size_t n, const std::function<void(size_t)> &fn) {
+  const size_t width = std::min(n, (size_t)parallel_width());
+  if (width <= 1) {
+    for (size_t i = 0; i < n; ++i)
+      fn(i);
+    return;
+  }
+  auto b = std::make_shared<Batch>();
+  b->fn = &fn;
+  b->n = n;
+  b->scope = tl_scope;
+  pool().push(b, width - 1);
+  b->run();
+  // 剩余下标已被其他线程领走，等它们完成（不会等待未开始的任务）
+  std::unique_lock<std::mutex> lk(b->mu);
+  b->cv.wait(lk, [&] { return b->done.load() == n; });
+}
+
+void parallel_rows(int h, const std::function<void(int, int)> &fn,
+                   int min_rows) {
+  if (h <= 0)
+    return;
+  // 条带数约为宽度的 4 倍，便于窃取均衡；每条至少 min_rows 行，摊薄调度开销
+  const int width = parallel_width();
+  const int rows =
+      std::max(std::max(min_rows, 1), (h + 4 * width - 1) / (4 * width));
+  const size_t strips = (size_t)((h + rows - 1) / rows);
+  parallel_for(strips, [&](size_t s) {
+    const int y0 = (int)s * rows;
+    fn(y0, std::min(h, y0 + rows));
+  });
+}
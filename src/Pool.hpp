@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// 进程内共享的工作窃取线程池（原生阶段的行条带/帧并行）。
+// 每个 parallel_for 是一个批次：调用线程推入若干令牌到各工作线程的双端队列，
+// 工作线程先取自己队尾、空了再从别人队首窃取；拿到令牌后从批次里原子领取下标执行。
+// 调用线程只参与自己批次的执行，等待期间不会替其他作业干活；嵌套调用（条带内再分）安全。
+// 所有缺陷作业共用同一个池，线程数 = available_cpus() - 1（调用者算一个）
+
+// 作用域：本线程及其派生任务的并行宽度，以及其他线程代为执行的 CPU 时间
+class ParallelScope {
+public:
+    explicit ParallelScope(int width); // width<=0 表示池的全部宽度
+    ~ParallelScope();
+    ParallelScope(const ParallelScope&) = delete;
+    ParallelScope& operator=(const ParallelScope&) = delete;
+    int width() const { return width_; }
+    double cpu_s() const { return (double)cpu_ns_.load() * 1e-9; }
+    void add_cpu_ns(uint64_t ns) { cpu_ns_.fetch_add(ns); }
+
+private:
+    int width_;
+    std::atomic<uint64_t> cpu_ns_{0};
+    ParallelScope* prev_;
+};
+
+// 当前线程的并行宽度（所在作用域的 width，无作用域时为池宽）
+int parallel_width();
+
+// 并行执行 fn(i)，i ∈ [0, n)，返回时全部完成；同时运行的下标不超过 parallel_width()
+void parallel_for(size_t n, const std::function<void(size_t)>& fn);
+
+// 把 [0, h) 行切成条带并行执行 fn(y0, y1)。需要邻域的内核（模糊等）自行按整个平面
+// 读取条带上下 halo 行（blur8_separable / box8_running 的 y0/y1 参数），条带只划分输出
+void parallel_rows(int h, const std::function<void(int, int)>& fn, int min_rows=16);
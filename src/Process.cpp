@@ -0,0 +1,454 @@
+#include "Process.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char **environ;
+#endif
+
+namespace {
+std::atomic<bool> g_cancel{false};
+constexpr size_t kErrTail = 4096; // 保留的 stderr 末尾字节数
+
+std::mutex g_usage_mu;
+ProcUsage g_usage;
+
+void add_usage(const ProcUsage &u) {
+  std::lock_guard<std::mutex> lk(g_usage_mu);
+  g_usage.cpu_s += u.cpu_s;
+  g_usage.max_rss_kb = std::max(g_usage.max_rss_kb, u.max_rss_kb);
+  g_usage.count += u.count;
+}
+
+double now_s() {
+  using namespace std::chrono;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+void cancel_all_procs() { g_cancel.store(true); }
+bool procs_cancelled() { return g_cancel.load(); }
+
+ProcUsage proc_usage_total(bool reset) {
+  std::lock_guard<std::mutex> lk(g_usage_mu);
+  ProcUsage u = g_usage;
+  if (reset)
+    g_usage = ProcUsage{};
+  return u;
+}
+
+std::string join_cmd(const std::vector<std::string> &args) {
+  // 组装成一条命令字符串（仅用于日志与 Windows 回退路径）
+  std::string cmd;
+  for (size_t i = 0; i < args.size(); ++i) {
+    if (i)
+      cmd += " ";
+    const std::string &a = args[i];
+    const bool alreadyQuoted =
+        a.size() && (a.front() == '"' || a.front() == '\'');
+    const bool hasSpaceOrQuote = a.find_first_of(" \t\"") != std::string::npos;
+    if (alreadyQuoted) {
+      cmd += a;
+    } else if (i == 0) {
+      // 对于可执行文件名，如果没有空格，不加引号，避免 PATH 搜索异常
+      if (hasSpaceOrQuote)
+        cmd += "\"" + a + "\"";
+      else
+        cmd += a;
+    } else {
+      cmd += "\"" + a + "\"";
+    }
+  }
+  return cmd;
+}
+
+void log_cmd(const std::string &cmd) {
+  // 并行任务共用 stderr，整行输出避免交错
+  static std::mutex log_mu;
+  std::lock_guard<std::mutex> lk(log_mu);
+  std::cerr << "[cmd] " << cmd << "\n";
+}
+
+Proc::~Proc() {
+  if (started_ && !exited_) {
+    kill();
+    wait();
+  }
+}
+
+void Proc::on_stdout(const char *p, size_t n) {
+  if (opt_.on_stdout)
+    opt_.on_stdout(p, n);
+  else
+    out_.append(p, n);
+}
+
+void Proc::on_stderr(const char *p, size_t n) {
+  if (err_log_.is_open())
+    err_log_.write(p, (std::streamsize)n);
+  err_tail_.append(p, n);
+  if (err_tail_.size() > 2 * kErrTail)
+    err_tail_.erase(0, err_tail_.size() - kErrTail);
+}
+
+void Proc::check_deadline() {
+  if (!started_ || exited_)
+    return;
+  if (deadline_ > 0 && now_s() > deadline_ && !timed_out_) {
+    timed_out_ = true;
+    kill();
+  } else if (g_cancel.load()) {
+    kill();
+  }
+}
+
+#ifndef _WIN32
+
+namespace {
+// 串行化 pipe 创建与 spawn，保证其他线程 spawn 的子进程不会继承本进程的管道端
+std::mutex g_spawn_mu;
+
+bool make_pipe(int fds[2]) {
+  if (pipe(fds) != 0)
+    return false;
+  for (int k = 0; k < 2; ++k)
+    fcntl(fds[k], F_SETFD, FD_CLOEXEC);
+  return true;
+}
+
+void set_nonblock(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+void close_fd(int &fd) {
+  if (fd >= 0)
+    ::close(fd);
+  fd = -1;
+}
+
+// 读空 fd；EOF 时关闭。返回是否读到数据
+template <class F> bool drain(int &fd, F &&sink) {
+  bool any = false;
+  char buf[16384];
+  while (fd >= 0) {
+    ssize_t r = ::read(fd, buf, sizeof(buf));
+    if (r > 0) {
+      sink(buf, (size_t)r);
+      any = true;
+    } else if (r == 0) {
+      close_fd(fd);
+    } else if (errno == EINTR) {
+      continue;
+    } else {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        close_fd(fd);
+      break;
+    }
+  }
+  return any;
+}
+} // namespace
+
+bool Proc::start(const std::vector<std::string> &argv,
+                 const ProcOptions &opt) {
+  if (started_ || argv.empty())
+    return false;
+  opt_ = opt;
+  if (!opt.stderr_log.empty()) {
+    err_log_.open(opt.stderr_log, std::ios::binary | std::ios::trunc);
+  }
+  if (opt.pipe_stdin) {
+    // 编码器提前退出时写管道会触发 SIGPIPE，改为由 write 返回 EPIPE
+    std::signal(SIGPIPE, SIG_IGN);
+  }
+
+  std::vector<char *> cargv;
+  for (auto &a : argv)
+    cargv.push_back(const_cast<char *>(a.c_str()));
+  cargv.push_back(nullptr);
+
+  std::lock_guard<std::mutex> lk(g_spawn_mu);
+  int pin[2] = {-1, -1}, pout[2] = {-1, -1}, perr[2] = {-1, -1};
+  const bool want_err = !opt.discard_stderr && !opt.stderr_log.empty();
+  const bool want_out = opt.capture_stdout || opt.on_stdout;
+  bool ok = (!opt.pipe_stdin || make_pipe(pin)) &&
+            (!want_out || make_pipe(pout)) &&
+            (!want_err || make_pipe(perr));
+
+  posix_spawn_file_actions_t fa;
+  posix_spawn_file_actions_init(&fa);
+  if (opt.pipe_stdin)
+    posix_spawn_file_actions_adddup2(&fa, pin[0], 0);
+  else
+    posix_spawn_file_actions_addopen(&fa, 0, "/dev/null", O_RDONLY, 0);
+  if (want_out)
+    posix_spawn_file_actions_adddup2(&fa, pout[1], 1);
+  if (opt.discard_stderr)
+    posix_spawn_file_actions_addopen(&fa, 2, "/dev/null", O_WRONLY, 0);
+  else if (want_err)
+    posix_spawn_file_actions_adddup2(&fa, perr[1], 2);
+
+  // 子进程自成进程组，kill 时连同其派生的进程一起结束
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+  posix_spawnattr_setpgroup(&attr, 0);
+
+  pid_t pid = -1;
+  if (ok)
+    ok = posix_spawnp(&pid, cargv[0], &fa, &attr, cargv.data(), environ) == 0;
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&fa);
+
+  close_fd(pin[0]);
+  close_fd(pout[1]);
+  close_fd(perr[1]);
+  if (!ok) {
+    close_fd(pin[1]);
+    close_fd(pout[0]);
+    close_fd(perr[0]);
+    return false;
+  }
+  pid_ = pid;
+  in_ = pin[1];
+  outp_ = pout[0];
+  errp_ = perr[0];
+  for (int fd : {in_, outp_, errp_})
+    if (fd >= 0)
+      set_nonblock(fd);
+  started_ = true;
+  deadline_ = opt.timeout_s > 0 ? now_s() + opt.timeout_s : 0;
+  return true;
+}
+
+long Proc::write_some(const void *data, size_t n) {
+  if (in_ < 0)
+    return -1;
+  for (;;) {
+    ssize_t w = ::write(in_, data, n);
+    if (w >= 0)
+      return (long)w;
+    if (errno == EINTR)
+      continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      return 0;
+    return -1;
+  }
+}
+
+bool Proc::write_all(const void *data, size_t n) {
+  const char *p = static_cast<const char *>(data);
+  while (n > 0) {
+    check_deadline();
+    if (exited_ || timed_out_ || g_cancel.load())
+      return false;
+    long w = write_some(p, n);
+    if (w < 0)
+      return false;
+    p += w;
+    n -= (size_t)w;
+    if (n == 0)
+      break;
+    // 管道已满：等待可写，同时排空 stdout/stderr，避免与子进程互相阻塞
+    pollfd fds[3];
+    int k = 0;
+    fds[k++] = {in_, POLLOUT, 0};
+    if (outp_ >= 0)
+      fds[k++] = {outp_, POLLIN, 0};
+    if (errp_ >= 0)
+      fds[k++] = {errp_, POLLIN, 0};
+    poll(fds, (nfds_t)k, 100);
+    drain(outp_, [&](const char *b, size_t m) { on_stdout(b, m); });
+    drain(errp_, [&](const char *b, size_t m) { on_stderr(b, m); });
+  }
+  return true;
+}
+
+void Proc::close_stdin() { close_fd(in_); }
+
+bool Proc::pump(int ms) {
+  pump_all({this}, ms);
+  return outp_ >= 0 || errp_ >= 0;
+}
+
+void pump_all(const std::vector<Proc *> &procs, int ms) {
+  std::vector<pollfd> fds;
+  for (Proc *p : procs) {
+    if (p->outp_ >= 0)
+      fds.push_back({p->outp_, POLLIN, 0});
+    if (p->errp_ >= 0)
+      fds.push_back({p->errp_, POLLIN, 0});
+  }
+  if (!fds.empty())
+    poll(fds.data(), (nfds_t)fds.size(), ms);
+  for (Proc *p : procs) {
+    drain(p->outp_, [&](const char *b, size_t m) { p->on_stdout(b, m); });
+    drain(p->errp_, [&](const char *b, size_t m) { p->on_stderr(b, m); });
+    p->check_deadline();
+  }
+}
+
+int Proc::wait() {
+  if (!started_)
+    return -1;
+  close_stdin();
+  while (pump(100)) {
+    // 被强制结束后不再等待仍持有管道的残留进程
+    if (killed_at_ > 0 && now_s() - killed_at_ > 1.0)
+      break;
+  }
+  int sleep_ms = 1;
+  while (!exited_) {
+    int st = 0;
+    struct rusage ru {};
+    pid_t r = wait4(pid_, &st, WNOHANG, &ru);
+    if (r == pid_) {
+      exited_ = true;
+      usage_.cpu_s = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6 +
+                     ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+#ifdef __APPLE__
+      usage_.max_rss_kb = ru.ru_maxrss / 1024; // macOS 以字节计
+#else
+      usage_.max_rss_kb = ru.ru_maxrss;
+#endif
+      usage_.count = 1;
+      add_usage(usage_);
+      if (WIFEXITED(st))
+        code_ = WEXITSTATUS(st);
+      else if (WIFSIGNALED(st))
+        code_ = 128 + WTERMSIG(st);
+      break;
+    }
+    if (r < 0 && errno != EINTR) {
+      exited_ = true;
+      break;
+    }
+    check_deadline();
+    std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+    sleep_ms = std::min(sleep_ms * 2, 20);
+  }
+  close_fd(outp_);
+  close_fd(errp_);
+  if (err_log_.is_open())
+    err_log_.close();
+  if (err_tail_.size() > kErrTail)
+    err_tail_.erase(0, err_tail_.size() - kErrTail);
+  return code_;
+}
+
+void Proc::kill() {
+  if (started_ && !exited_ && pid_ > 0) {
+    ::kill(-pid_, SIGKILL);
+    if (killed_at_ == 0)
+      killed_at_ = now_s();
+  }
+}
+
+#else // _WIN32：经 shell 的简化实现，不支持超时与非阻塞 I/O
+
+bool Proc::start(const std::vector<std::string> &argv,
+                 const ProcOptions &opt) {
+  if (started_ || argv.empty())
+    return false;
+  opt_ = opt;
+  cmd_ = join_cmd(argv);
+  if (opt.discard_stderr)
+    cmd_ += " 2> NUL";
+  else if (!opt.stderr_log.empty())
+    cmd_ += " 2> \"" + opt.stderr_log + "\"";
+  if (opt.pipe_stdin) {
+    pipe_ = _popen(cmd_.c_str(), "wb");
+    if (!pipe_)
+      return false;
+  } else if (opt.capture_stdout || opt.on_stdout) {
+    pipe_ = _popen(cmd_.c_str(), "rb");
+    if (!pipe_)
+      return false;
+  }
+  started_ = true;
+  return true;
+}
+
+long Proc::write_some(const void *data, size_t n) {
+  if (!pipe_ || !opt_.pipe_stdin)
+    return -1;
+  size_t w = fwrite(data, 1, n, (FILE *)pipe_);
+  return w == n ? (long)w : -1;
+}
+
+bool Proc::write_all(const void *data, size_t n) {
+  if (g_cancel.load())
+    return false;
+  return write_some(data, n) == (long)n;
+}
+
+void Proc::close_stdin() {}
+
+bool Proc::pump(int) { return false; }
+
+void pump_all(const std::vector<Proc *> &, int) {}
+
+int Proc::wait() {
+  if (!started_)
+    return -1;
+  if (exited_)
+    return code_;
+  if (pipe_) {
+    if (opt_.capture_stdout || opt_.on_stdout) {
+      char buf[4096];
+      size_t n;
+      while ((n = fread(buf, 1, sizeof(buf), (FILE *)pipe_)) > 0)
+        on_stdout(buf, n);
+    }
+    code_ = _pclose((FILE *)pipe_);
+    pipe_ = nullptr;
+  } else {
+    code_ = std::system(cmd_.c_str());
+  }
+  exited_ = true;
+  if (!opt_.stderr_log.empty()) {
+    std::ifstream ifs(opt_.stderr_log, std::ios::binary);
+    std::string s((std::istreambuf_iterator<char>(ifs)),
+                  std::istreambuf_iterator<char>());
+    err_tail_ = s.size() > kErrTail ? s.substr(s.size() - kErrTail) : s;
+  }
+  return code_;
+}
+
+void Proc::kill() {}
+
+#endif
+
+int run_cmd(const std::vector<std::string> &args, const ProcOptions &opt) {
+  log_cmd(join_cmd(args));
+  Proc p;
+  if (!p.start(args, opt))
+    return -1;
+  return p.wait();
+}
+
+std::string exec_read_all(const std::vector<std::string> &args) {
+  ProcOptions opt;
+  opt.capture_stdout = true;
+  opt.discard_stderr = true;
+  Proc p;
+  if (!p.start(args, opt))
+    return std::string();
+  p.wait();
+  return p.out();
+}
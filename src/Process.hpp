@@ -1,26 +1,91 @@
 #pragma once
 #include <string>
 #include <vector>
-#include <iostream>
-#include <cstdlib>
-
-inline int run_cmd(const std::vector<std::string>& args) {
-    // 组装成一条命令字符串（简单做法：system）
-    std::string cmd;
-    for (size_t i=0;i<args.size();++i) {
-        if (i) cmd += " ";
-        const std::string& a = args[i];
-        const bool alreadyQuoted = a.size() && (a.front()=='"' || a.front()=='\'');
-        const bool hasSpaceOrQuote = a.find_first_of(" \t\"") != std::string::npos;
-        if (alreadyQuoted) {
-            cmd += a;
-        } else if (i==0) {
-            // 对于可执行文件名，如果没有空格，不加引号，避免 PATH 搜索异常
-            if (hasSpaceOrQuote) cmd += "\"" + a + "\""; else cmd += a;
-        } else {
-            cmd += "\"" + a + "\"";
-        }
-    }
-    std::cerr << "[cmd] " << cmd << "\n";
-    return std::system(cmd.c_str());
-}
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+
+// 子进程运行时：POSIX 上用 posix_spawnp 直接传 argv（不经 shell），
+// stdin/stdout/stderr 为非阻塞管道，由调用线程 poll 驱动；Windows 上回退到 shell。
+
+struct ProcOptions {
+    bool pipe_stdin=false;      // 由父进程写入 stdin；否则 stdin 接 /dev/null
+    bool capture_stdout=false;  // 收集 stdout 到 Proc::out()；否则继承
+    std::function<void(const char*, size_t)> on_stdout; // 非空：stdout 交给回调（不收集）
+    bool discard_stderr=false;  // stderr 丢弃
+    std::string stderr_log;     // 非空：stderr 写入该文件（并保留末尾若干字节）
+    double timeout_s=0;         // >0：超时后强制结束
+};
+
+// 子进程资源占用（POSIX 上由 wait4 取得；Windows 回退路径为 0）
+struct ProcUsage {
+    double cpu_s=0;     // user+sys 秒
+    long max_rss_kb=0;  // 峰值常驻内存
+    size_t count=0;     // 已结束的子进程数
+};
+
+class Proc {
+public:
+    Proc() = default;
+    ~Proc();
+    Proc(const Proc&) = delete;
+    Proc& operator=(const Proc&) = delete;
+
+    bool start(const std::vector<std::string>& argv, const ProcOptions& opt={});
+    // 写满 n 字节（期间继续排空 stdout/stderr）；子进程已退出/超时/取消时返回 false
+    bool write_all(const void* data, size_t n);
+    // 非阻塞写，返回写入字节数；出错返回 -1
+    long write_some(const void* data, size_t n);
+    void close_stdin();
+    // 处理一次 I/O 事件，最多等待 ms 毫秒；返回子进程是否仍有未关闭的输出
+    bool pump(int ms);
+    // 关闭 stdin、排空输出并等待退出，返回退出码（被信号结束为 128+sig，启动失败为 -1）
+    int wait();
+    void kill();
+
+    bool started() const { return started_; }
+    bool timed_out() const { return timed_out_; }
+    const std::string& out() const { return out_; }
+    const std::string& err_tail() const { return err_tail_; }
+    const ProcUsage& usage() const { return usage_; }
+
+private:
+    friend void pump_all(const std::vector<Proc*>& procs, int ms);
+    void on_stdout(const char* p, size_t n);
+    void on_stderr(const char* p, size_t n);
+    void check_deadline();
+
+    ProcOptions opt_;
+    bool started_=false, exited_=false, timed_out_=false;
+    int code_=-1;
+    std::string out_, err_tail_;
+    ProcUsage usage_;
+    std::ofstream err_log_;
+    double deadline_=0, killed_at_=0;
+#ifdef _WIN32
+    std::string cmd_;
+    void* pipe_=nullptr; // FILE*
+#else
+    int pid_=-1;
+    int in_=-1, outp_=-1, errp_=-1;
+#endif
+};
+
+// 在一个线程里同时驱动多个子进程的输出管道
+void pump_all(const std::vector<Proc*>& procs, int ms);
+
+// 取消：所有运行中的子进程在下一次 pump/wait 时被强制结束（可在信号处理函数中调用）
+void cancel_all_procs();
+bool procs_cancelled();
+
+// 所有已结束子进程的累计占用（cpu 求和、rss 取最大）；reset=true 时同时清零
+ProcUsage proc_usage_total(bool reset=false);
+
+std::string join_cmd(const std::vector<std::string>& args);
+void log_cmd(const std::string& cmd);
+
+// 运行命令直至退出，返回退出码（0=成功）
+int run_cmd(const std::vector<std::string>& args, const ProcOptions& opt={});
+// 运行命令并返回其 stdout（stderr 丢弃）；失败返回空串
+std::string exec_read_all(const std::vector<std::string>& args);
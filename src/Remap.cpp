@@ -0,0 +1,45 @@
+#include "Remap.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+
+FrameMap identity_map(size_t n) {
+  FrameMap m(n);
+  for (size_t i = 0; i < n; ++i)
+    m[i] = (uint32_t)i;
+  return m;
+}
+
+void map_freeze(FrameMap &m, size_t first, size_t count) {
+  if (first == 0 || first >= m.size())
+    return;
+  const size_t end = std::min(m.size(), first + count);
+  std::fill(m.begin() + first, m.begin() + end, m[first - 1]);
+}
+
+void map_drop(FrameMap &m, size_t first, size_t count) {
+  if (first >= m.size())
+    return;
+  const size_t end = std::min(m.size(), first + count);
+  m.erase(m.begin() + first, m.begin() + end);
+}
+
+void map_duplicate(FrameMap &m, size_t at, size_t times) {
+  if (at >= m.size())
+    return;
+  m.insert(m.begin() + at + 1, times, m[at]);
+}
+
+void map_swap(FrameMap &m, size_t a, size_t b) {
+  if (a < m.size() && b < m.size())
+    std::swap(m[a], m[b]);
+}
+
+bool map_valid(const FrameMap &m, size_t frames) {
+  return std::all_of(m.begin(), m.end(),
+                     [&](uint32_t v) { return (size_t)v < frames; });
+}
+
+std::string map_signature(const FrameMap &m) {
+  return "map:" + std::to_string(m.size()) + ":" +
+         hex64(hash64(m.data(), m.size() * sizeof(uint32_t)));
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 帧序重映射：输出第 i 帧取自输入第 map[i] 帧。
+// 重复/丢帧/交换/冻结都只是对下标表的变换，原生路径按表从映射输入直接取帧送编码器
+
+using FrameMap = std::vector<uint32_t>;
+
+FrameMap identity_map(size_t n);
+
+// [first, first+count) 全部显示 first-1 的画面（帧数不变）；first=0 时无效
+void map_freeze(FrameMap& m, size_t first, size_t count);
+// 删除 [first, first+count)（帧数减少）
+void map_drop(FrameMap& m, size_t first, size_t count);
+// 第 at 帧之后插入 times 个它的副本（帧数增加）
+void map_duplicate(FrameMap& m, size_t at, size_t times);
+// 交换两帧
+void map_swap(FrameMap& m, size_t a, size_t b);
+
+// 所有下标都 < frames 时返回 true
+bool map_valid(const FrameMap& m, size_t frames);
+// 参与缓存键的紧凑描述（下标表的哈希与长度）
+std::string map_signature(const FrameMap& m);
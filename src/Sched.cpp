@@ -0,0 +1,153 @@
+#include "Sched.hpp"
+#include "Jobs.hpp"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// 进程允许运行的 CPU 编号（绑核时从中分配）
+std::vector<int> allowed_cpus() {
+  std::vector<int> v;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int c = 0; c < CPU_SETSIZE; ++c)
+      if (CPU_ISSET(c, &set))
+        v.push_back(c);
+  }
+#endif
+  if (v.empty()) {
+    v.resize((size_t)hw_threads());
+    std::iota(v.begin(), v.end(), 0);
+  }
+  return v;
+}
+
+#ifdef __linux__
+bool set_thread_cpus(const std::vector<int> &cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int c : cpus)
+    CPU_SET(c, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+#endif
+
+} // namespace
+
+int available_cpus() { return (int)allowed_cpus().size(); }
+
+int useful_threads(int w, int h) {
+  // 经验值：CIF≈1，720p≈4，1080p≈6，4K≈13；x264 的帧并行受限于 lookahead 与行数
+  const double px = (double)std::max(w, 1) * (double)std::max(h, 1);
+  const int t = (int)std::lround(std::sqrt(px / 50000.0));
+  return std::max(1, std::min(16, t));
+}
+
+void run_scheduled(const std::vector<TaskCost> &costs, const SchedOptions &opt,
+                   const std::function<void(size_t, const CpuSlot &)> &fn) {
+  const size_t n = costs.size();
+  if (n == 0)
+    return;
+  const std::vector<int> cpus = allowed_cpus();
+  const int budget = opt.budget > 0 ? opt.budget : (int)cpus.size();
+  // 固定并发时每个任务均分预算；预算小于并发数时每个任务至少 1 个线程
+  const int tokens = opt.max_jobs > 0 ? std::max(budget, opt.max_jobs) : budget;
+  const int fixed = opt.max_jobs > 0 ? std::max(1, budget / opt.max_jobs) : 0;
+  const bool bind = opt.affinity && budget <= (int)cpus.size();
+
+  // LPT：大任务先启动，尾部由小任务填满
+  std::vector<size_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return costs[a].work > costs[b].work;
+  });
+
+  std::mutex mu;
+  std::condition_variable cv;
+  size_t next = 0;    // 下一个领取的序号
+  size_t serving = 0; // 正在等待预算的序号：严格按序分配，避免小任务饿死大任务
+  int free_tokens = tokens;
+  std::vector<char> busy(cpus.size(), 0);
+
+  auto worker = [&]() {
+#ifdef __linux__
+    cpu_set_t orig;
+    const bool have_orig =
+        bind && pthread_getaffinity_np(pthread_self(), sizeof(orig), &orig) == 0;
+#endif
+    for (;;) {
+      CpuSlot slot;
+      size_t k;
+      int grant;
+      {
+        std::unique_lock<std::mutex> lk(mu);
+        if (next >= n)
+          return;
+        k = next++;
+        const TaskCost &c = costs[order[k]];
+        const int need =
+            fixed ? fixed : std::max(1, std::min(c.threads, tokens));
+        cv.wait(lk, [&] { return serving == k && free_tokens >= need; });
+        // 队尾：剩余任务不足以占满预算时，把空闲线程分给它们
+        grant = need;
+        if (!fixed) {
+          const int left = (int)(n - k);
+          grant = std::max(need, std::min(free_tokens, free_tokens / left));
+        }
+        free_tokens -= grant;
+        ++serving;
+        if (bind) {
+          for (size_t i = 0; i < busy.size() && (int)slot.cpus.size() < grant;
+               ++i)
+            if (!busy[i]) {
+              busy[i] = 1;
+              slot.cpus.push_back(cpus[i]);
+            }
+        }
+        cv.notify_all();
+      }
+      // 串行且未指定预算时不限制，保持 ffmpeg 的默认线程数
+      slot.threads = (opt.max_jobs == 1 && opt.budget == 0) ? 0 : grant;
+#ifdef __linux__
+      if (!slot.cpus.empty())
+        set_thread_cpus(slot.cpus);
+#endif
+      fn(order[k], slot);
+#ifdef __linux__
+      if (!slot.cpus.empty() && have_orig)
+        pthread_setaffinity_np(pthread_self(), sizeof(orig), &orig);
+#endif
+      {
+        std::lock_guard<std::mutex> lk(mu);
+        free_tokens += grant;
+        for (int c : slot.cpus)
+          busy[std::find(cpus.begin(), cpus.end(), c) - cpus.begin()] = 0;
+        cv.notify_all();
+      }
+    }
+  };
+
+  // 每个运行中的任务至少占 1 个线程预算，工作线程数不超过可能的并发数
+  const size_t k = std::min(n, (size_t)(fixed ? opt.max_jobs : tokens));
+  if (k <= 1) {
+    worker();
+    return;
+  }
+  std::vector<std::thread> pool;
+  pool.reserve(k);
+  for (size_t t = 0; t < k; ++t)
+    pool.emplace_back(worker);
+  for (auto &th : pool)
+    th.join();
+}
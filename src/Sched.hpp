@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// 核预算调度：把 CPU 线程分给同时运行的 ffmpeg，避免多个编码器各自按全部核数开线程
+
+// 当前进程可用的 CPU 数（Linux 上尊重 taskset/cgroup 的亲和性掩码）
+int available_cpus();
+
+// 单个编码任务能有效利用的线程数：x264 按帧/行并行，收益随分辨率增长
+int useful_threads(int w, int h);
+
+struct TaskCost {
+    double work=1;  // 相对开销（像素×帧数×权重），用于排序
+    int threads=1;  // 有效线程数上限
+};
+
+// 分配给一个任务的资源
+struct CpuSlot {
+    int threads=0;          // 传给 ffmpeg 的 -threads/-filter_threads（0=不限制）
+    std::vector<int> cpus;  // 绑定的 CPU（空=不绑核）
+};
+
+struct SchedOptions {
+    int budget=0;       // 总线程预算，0=available_cpus()
+    int max_jobs=0;     // >0：固定并发数，每个任务均分预算；0=按开销自动决定
+    bool affinity=false;// 把任务（及其子进程）绑定到互不重叠的 CPU 上
+};
+
+// 按开销从大到小依次启动（LPT），预算不足时排队；fn 在工作线程里执行，
+// 绑核时该线程在 fn 期间的亲和性即为 slot.cpus，此时启动的子进程随之继承
+void run_scheduled(const std::vector<TaskCost>& costs, const SchedOptions& opt,
+                   const std::function<void(size_t, const CpuSlot&)>& fn);
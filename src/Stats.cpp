@@ -0,0 +1,169 @@
+#include "Stats.hpp"
+#include "Jobs.hpp"
+#include "Kernels.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+void PlaneStats::finalize() {
+  count = 0;
+  uint64_t sum = 0;
+  min = 255;
+  max = 0;
+  for (int v = 0; v < 256; ++v) {
+    if (!hist[v])
+      continue;
+    count += hist[v];
+    sum += hist[v] * (uint64_t)v;
+    min = std::min(min, v);
+    max = std::max(max, v);
+  }
+  if (count == 0)
+    min = max = 0;
+  mean = count ? (double)sum / (double)count : 0.0;
+}
+
+int PlaneStats::quantile(double q) const {
+  const uint64_t cutoff = (uint64_t)((double)count * q);
+  uint64_t acc = 0;
+  for (int v = 0; v < 256; ++v) {
+    acc += hist[v];
+    if (acc >= cutoff && acc > 0)
+      return v;
+  }
+  return 255;
+}
+
+void ClipStats::aggregate() {
+  total = FrameStats{};
+  for (auto &f : per_frame) {
+    total.planes = std::max(total.planes, f.planes);
+    for (int k = 0; k < f.planes; ++k)
+      for (int v = 0; v < 256; ++v)
+        total.p[k].hist[v] += f.p[k].hist[v];
+  }
+  for (int k = 0; k < total.planes; ++k)
+    total.p[k].finalize();
+}
+
+size_t stats_step_for(size_t frames, size_t step) {
+  return step ? step : std::max<size_t>(1, (frames + 239) / 240);
+}
+
+ClipStats compute_clip_stats(const FrameSource &src, size_t step,
+                             int workers) {
+  ClipStats cs;
+  cs.frames = src.frame_count();
+  step = stats_step_for(cs.frames, step);
+  cs.step = step;
+  const size_t n = cs.frames ? (cs.frames + step - 1) / step : 0;
+  cs.per_frame.resize(n);
+  run_jobs(n, workers, [&](size_t i) {
+    FrameStats &fs = cs.per_frame[i];
+    fs.index = i * step;
+    FrameView f = src.frame(fs.index);
+    fs.planes = f.planes;
+    for (int k = 0; k < f.planes; ++k) {
+      const PlaneView &pv = f.p[k];
+      uint32_t h[256] = {0};
+      // 单平面不超过 4G 像素，uint32 计数足够
+      if (pv.stride == (size_t)pv.w) {
+        hist8_accumulate(pv.data, (size_t)pv.w * pv.h, h);
+      } else {
+        for (int r = 0; r < pv.h; ++r)
+          hist8_accumulate(pv.row(r), (size_t)pv.w, h);
+      }
+      for (int v = 0; v < 256; ++v)
+        fs.p[k].hist[v] = h[v];
+      fs.p[k].finalize();
+    }
+  });
+  cs.aggregate();
+  return cs;
+}
+
+std::string stats_key(const fs::path &input, const FrameGeometry &g,
+                      size_t step) {
+  std::error_code ec;
+  std::ostringstream ss;
+  ss << "size=" << fs::file_size(input, ec);
+  ss << " mtime=" << fs::last_write_time(input, ec).time_since_epoch().count();
+  ss << " geo=" << g.plane[0].w << "x" << g.plane[0].h << "/" << g.planes
+     << "/" << g.cw_shift << g.ch_shift << " step=" << step;
+  return ss.str();
+}
+
+namespace {
+const char kMagic[8] = {'Y', 'C', 'S', 'T', 'A', 'T', 'S', '1'};
+
+template <class T> void put(std::ofstream &o, const T &v) {
+  o.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+template <class T> bool get(std::ifstream &i, T &v) {
+  return (bool)i.read(reinterpret_cast<char *>(&v), sizeof(T));
+}
+} // namespace
+
+bool save_stats(const fs::path &p, const std::string &key,
+                const ClipStats &s) {
+  std::ofstream o(p, std::ios::binary | std::ios::trunc);
+  if (!o)
+    return false;
+  o.write(kMagic, sizeof(kMagic));
+  put(o, (uint32_t)key.size());
+  o.write(key.data(), (std::streamsize)key.size());
+  put(o, (uint64_t)s.frames);
+  put(o, (uint64_t)s.step);
+  put(o, (uint64_t)s.per_frame.size());
+  for (auto &f : s.per_frame) {
+    put(o, (uint64_t)f.index);
+    put(o, (uint32_t)f.planes);
+    for (int k = 0; k < f.planes; ++k)
+      o.write(reinterpret_cast<const char *>(f.p[k].hist.data()),
+              sizeof(uint64_t) * 256);
+  }
+  return (bool)o;
+}
+
+bool load_stats(const fs::path &p, const std::string &key, ClipStats &out) {
+  std::ifstream i(p, std::ios::binary);
+  if (!i)
+    return false;
+  char magic[sizeof(kMagic)];
+  if (!i.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, kMagic, sizeof(kMagic)) != 0)
+    return false;
+  uint32_t klen = 0;
+  if (!get(i, klen) || klen > 4096)
+    return false;
+  std::string k(klen, '\0');
+  if (!i.read(&k[0], klen) || k != key)
+    return false;
+  uint64_t frames = 0, step = 0, n = 0;
+  if (!get(i, frames) || !get(i, step) || !get(i, n) || n > frames)
+    return false;
+  ClipStats s;
+  s.frames = (size_t)frames;
+  s.step = (size_t)step;
+  s.per_frame.resize((size_t)n);
+  for (auto &f : s.per_frame) {
+    uint64_t idx = 0;
+    uint32_t planes = 0;
+    if (!get(i, idx) || !get(i, planes) || planes > 3)
+      return false;
+    f.index = (size_t)idx;
+    f.planes = (int)planes;
+    for (int k = 0; k < f.planes; ++k) {
+      if (!i.read(reinterpret_cast<char *>(f.p[k].hist.data()),
+                  sizeof(uint64_t) * 256))
+        return false;
+      f.p[k].finalize();
+    }
+  }
+  s.aggregate();
+  out = std::move(s);
+  return true;
+}
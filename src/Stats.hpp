@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "FrameSource.hpp"
+
+// 单个平面的直方图统计；min/max/mean 由直方图推出
+struct PlaneStats {
+    std::array<uint64_t, 256> hist{};
+    uint64_t count=0;
+    int min=0, max=0;
+    double mean=0;
+
+    void finalize();
+    // 最小的 v，使 hist[0..v] 的累计占比 >= q
+    int quantile(double q) const;
+};
+
+struct FrameStats {
+    size_t index=0;
+    int planes=0;
+    PlaneStats p[3];
+};
+
+// 整段（或采样子集）的逐帧与聚合统计
+struct ClipStats {
+    size_t frames=0;                  // 片段总帧数
+    size_t step=1;                    // 采样间隔（每 step 帧统计一帧）
+    std::vector<FrameStats> per_frame;
+    FrameStats total;                 // 所有采样帧的聚合
+
+    void aggregate();
+};
+
+// step=0 时自动选择：最多采样约 240 帧
+size_t stats_step_for(size_t frames, size_t step);
+// 按 stats_step_for 采样；workers 个线程并行统计
+ClipStats compute_clip_stats(const FrameSource& src, size_t step, int workers);
+
+// 旁路缓存：key 描述输入文件与统计参数，不匹配时视为未命中
+std::string stats_key(const std::filesystem::path& input, const FrameGeometry& g,
+                      size_t step);
+bool load_stats(const std::filesystem::path& p, const std::string& key, ClipStats& out);
+bool save_stats(const std::filesystem::path& p, const std::string& key, const ClipStats& s);
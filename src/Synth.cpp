@@ -0,0 +1,124 @@
+#include "Synth.hpp"
+#include "Fs.hpp"
+#include <algorithm>
+#include <fstream>
+
+namespace {
+
+uint64_t splitmix64(uint64_t &s) {
+  uint64_t z = (s += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+void fill_gradient(uint8_t *y, uint8_t *u, uint8_t *v, int w, int h, int cw,
+                   int ch, size_t n) {
+  const int shift = (int)(n % 256);
+  for (int j = 0; j < h; ++j)
+    for (int i = 0; i < w; ++i)
+      y[(size_t)j * w + i] =
+          (uint8_t)(16 + ((i * 219 / std::max(1, w - 1) +
+                           j * 64 / std::max(1, h - 1) + shift) %
+                          220));
+  for (int j = 0; j < ch; ++j)
+    for (int i = 0; i < cw; ++i) {
+      u[(size_t)j * cw + i] = (uint8_t)(64 + i * 128 / std::max(1, cw - 1));
+      v[(size_t)j * cw + i] = (uint8_t)(64 + j * 128 / std::max(1, ch - 1));
+    }
+}
+
+void fill_noise(uint8_t *p, size_t bytes, uint64_t seed, size_t n) {
+  uint64_t s = seed ^ (n * 0xd1b54a32d192ed03ULL);
+  size_t i = 0;
+  for (; i + 8 <= bytes; i += 8) {
+    uint64_t r = splitmix64(s);
+    for (int k = 0; k < 8; ++k)
+      p[i + k] = (uint8_t)(r >> (8 * k));
+  }
+  uint64_t r = splitmix64(s);
+  for (int k = 0; i < bytes; ++i, ++k)
+    p[i] = (uint8_t)(r >> (8 * k));
+}
+
+void fill_edges(uint8_t *y, uint8_t *u, uint8_t *v, int w, int h, int cw,
+                int ch, size_t n) {
+  // 每帧右移 2 像素的 16 像素竖条，叠加每帧下移 1 像素的 32 像素棋盘格
+  const int dx = (int)(2 * n), dy = (int)n;
+  for (int j = 0; j < h; ++j)
+    for (int i = 0; i < w; ++i) {
+      const bool bar = ((i + dx) / 16) & 1;
+      const bool chk = (((i / 32) ^ ((j + dy) / 32)) & 1) != 0;
+      y[(size_t)j * w + i] = (uint8_t)(bar ? (chk ? 235 : 180) : (chk ? 80 : 16));
+    }
+  for (int j = 0; j < ch; ++j)
+    for (int i = 0; i < cw; ++i) {
+      const bool bar = ((2 * i + dx) / 16) & 1;
+      u[(size_t)j * cw + i] = bar ? 90 : 160;
+      v[(size_t)j * cw + i] = bar ? 200 : 110;
+    }
+}
+
+} // namespace
+
+const char *synth_name(SynthContent c) {
+  switch (c) {
+  case SynthContent::Gradient:
+    return "gradient";
+  case SynthContent::Noise:
+    return "noise";
+  default:
+    return "edges";
+  }
+}
+
+bool synth_parse(const std::string &s, SynthContent &c) {
+  if (s == "gradient")
+    c = SynthContent::Gradient;
+  else if (s == "noise")
+    c = SynthContent::Noise;
+  else if (s == "edges")
+    c = SynthContent::Edges;
+  else
+    return false;
+  return true;
+}
+
+void synth_frame(SynthContent c, int w, int h, size_t n, uint64_t seed,
+                 std::vector<uint8_t> &buf) {
+  w += w & 1;
+  h += h & 1;
+  const int cw = w / 2, ch = h / 2;
+  const size_t ys = (size_t)w * h, cs = (size_t)cw * ch;
+  buf.resize(ys + 2 * cs);
+  uint8_t *y = buf.data(), *u = y + ys, *v = u + cs;
+  switch (c) {
+  case SynthContent::Gradient:
+    fill_gradient(y, u, v, w, h, cw, ch, n);
+    break;
+  case SynthContent::Noise:
+    fill_noise(buf.data(), buf.size(), seed, n);
+    break;
+  case SynthContent::Edges:
+    fill_edges(y, u, v, w, h, cw, ch, n);
+    break;
+  }
+}
+
+bool synth_write(const fs::path &path, SynthContent c, int w, int h,
+                 size_t frames, uint64_t seed) {
+  std::vector<uint8_t> buf;
+  synth_frame(c, w, h, 0, seed, buf);
+  if (file_size_or(path) == buf.size() * frames)
+    return true;
+  std::ofstream ofs(path, std::ios::binary);
+  if (!ofs)
+    return false;
+  for (size_t n = 0; n < frames; ++n) {
+    if (n)
+      synth_frame(c, w, h, n, seed, buf);
+    ofs.write(reinterpret_cast<const char *>(buf.data()),
+              (std::streamsize)buf.size());
+  }
+  return (bool)ofs;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// 合成测试片段（yuv420p 8-bit）：内容只由 (类型, 尺寸, 帧号, seed) 决定，可重复生成
+
+enum class SynthContent {
+    Gradient, // 缓慢平移的对角渐变（平坦区域，利于观察 banding/blocky）
+    Noise,    // 逐帧独立的均匀噪声（编码器最坏情况）
+    Edges,    // 移动的竖条与棋盘格（jitter/ringing/ghosting 的高频边缘）
+};
+
+const char* synth_name(SynthContent c);
+// "gradient" / "noise" / "edges"；无法识别返回 false
+bool synth_parse(const std::string& s, SynthContent& c);
+
+// 生成第 n 帧到 buf（大小 w*h*3/2，宽高向上取偶）
+void synth_frame(SynthContent c, int w, int h, size_t n, uint64_t seed,
+                 std::vector<uint8_t>& buf);
+
+// 写出 frames 帧到 path；文件已存在且大小一致时直接复用
+bool synth_write(const std::filesystem::path& path, SynthContent c, int w, int h,
+                 size_t frames, uint64_t seed);
@@ -0,0 +1,152 @@
+#include "Telemetry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+void FfProgress::feed(const char *p, size_t n) {
+  buf_.append(p, n);
+  size_t s = 0;
+  for (size_t e; (e = buf_.find('\n', s)) != std::string::npos; s = e + 1)
+    line(buf_.substr(s, e - s));
+  buf_.erase(0, s);
+}
+
+void FfProgress::line(const std::string &l) {
+  const size_t eq = l.find('=');
+  if (eq == std::string::npos)
+    return;
+  const std::string k = l.substr(0, eq), v = l.substr(eq + 1);
+  if (k == "frame")
+    frame_ = std::strtoull(v.c_str(), nullptr, 10);
+  else if (k == "speed")
+    speed_ = std::strtod(v.c_str(), nullptr); // "1.23x" / "N/A"
+  else if (k == "progress")
+    ended_ = v.rfind("end", 0) == 0;
+}
+
+namespace {
+
+struct Board {
+  std::mutex mu;
+  size_t jobs = 0, jobs_done = 0;
+  uint64_t frames = 0, frames_done = 0;
+  std::chrono::steady_clock::time_point start, last;
+  bool started = false;
+};
+
+Board &board() {
+  static Board b;
+  return b;
+}
+
+std::string hms(double s) {
+  long t = (long)(s + 0.5);
+  char buf[32];
+  if (t >= 3600)
+    std::snprintf(buf, sizeof(buf), "%ld:%02ld:%02ld", t / 3600, t / 60 % 60,
+                  t % 60);
+  else
+    std::snprintf(buf, sizeof(buf), "%02ld:%02ld", t / 60, t % 60);
+  return buf;
+}
+
+// 调用方持锁
+void report(Board &b, bool force) {
+  const auto now = std::chrono::steady_clock::now();
+  if (!force && now - b.last < std::chrono::seconds(2))
+    return;
+  b.last = now;
+  const double el = std::chrono::duration<double>(now - b.start).count();
+  const double fps = el > 0 ? b.frames_done / el : 0;
+  std::ostringstream ss;
+  ss << "[progress] jobs " << b.jobs_done << "/" << b.jobs << " frames "
+     << b.frames_done << "/" << b.frames;
+  char f[32];
+  std::snprintf(f, sizeof(f), " %.1f fps", fps);
+  ss << f << " elapsed " << hms(el);
+  if (fps > 0 && b.frames_done < b.frames)
+    ss << " ETA " << hms((b.frames - b.frames_done) / fps);
+  std::cerr << ss.str() + "\n";
+}
+
+} // namespace
+
+void progress_add(size_t jobs, uint64_t frames) {
+  Board &b = board();
+  std::lock_guard<std::mutex> lk(b.mu);
+  if (!b.started) {
+    b.started = true;
+    b.start = b.last = std::chrono::steady_clock::now();
+  }
+  b.jobs += jobs;
+  b.frames += frames;
+}
+
+void JobProgress::update(uint64_t frames) {
+  frames = std::min(frames, expected_);
+  if (frames <= reported_)
+    return;
+  Board &b = board();
+  std::lock_guard<std::mutex> lk(b.mu);
+  b.frames_done += frames - reported_;
+  reported_ = frames;
+  report(b, false);
+}
+
+JobProgress::~JobProgress() {
+  Board &b = board();
+  std::lock_guard<std::mutex> lk(b.mu);
+  b.frames_done += expected_ - reported_;
+  ++b.jobs_done;
+  // 全部完成时输出最终一行
+  report(b, b.jobs_done == b.jobs);
+}
+
+double thread_cpu_s() {
+#ifndef _WIN32
+  timespec ts{};
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+  return 0;
+}
+
+std::string json_quote(const std::string &s) {
+  std::string r = "\"";
+  for (unsigned char c : s) {
+    switch (c) {
+    case '"':
+      r += "\\\"";
+      break;
+    case '\\':
+      r += "\\\\";
+      break;
+    case '\n':
+      r += "\\n";
+      break;
+    case '\r':
+      r += "\\r";
+      break;
+    case '\t':
+      r += "\\t";
+      break;
+    default:
+      if (c < 0x20) {
+        char u[8];
+        std::snprintf(u, sizeof(u), "\\u%04x", c);
+        r += u;
+      } else {
+        r += (char)c;
+      }
+    }
+  }
+  return r + "\"";
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 任务遥测：ffmpeg -progress 解析、全局进度/ETA、线程 CPU 时间、JSON 字符串转义
+
+// 解析 `-progress pipe:1` 输出的 key=value 行（可分段喂入）
+class FfProgress {
+public:
+    void feed(const char* p, size_t n);
+    uint64_t frame() const { return frame_; }
+    double speed() const { return speed_; }   // 相对实时倍速，未知为 0
+    bool ended() const { return ended_; }     // 收到 progress=end
+
+private:
+    void line(const std::string& l);
+    std::string buf_;
+    uint64_t frame_=0;
+    double speed_=0;
+    bool ended_=false;
+};
+
+// 登记将要运行的任务数与帧数（所有输出帧数之和），供进度与 ETA 使用
+void progress_add(size_t jobs, uint64_t frames);
+
+// 单个任务的进度；析构时按预计帧数计为完成。
+// 汇总状态至多每 2 秒输出一行到 stderr：任务数、帧数、总 fps 与 ETA
+class JobProgress {
+public:
+    explicit JobProgress(uint64_t expected) : expected_(expected) {}
+    ~JobProgress();
+    JobProgress(const JobProgress&) = delete;
+    JobProgress& operator=(const JobProgress&) = delete;
+    void update(uint64_t frames);
+
+private:
+    uint64_t expected_, reported_=0;
+};
+
+// 当前线程的 CPU 时间（秒）；不支持的平台返回 0
+double thread_cpu_s();
+
+// JSON 字符串字面量（含引号），控制字符转义为 \n/\t/\u00XX
+std::string json_quote(const std::string& s);
@@ -0,0 +1,151 @@
+#include "Y4m.hpp"
+#include "FrameSource.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+const char kSig[] = "YUV4MPEG2";
+const char kIdxMagic[8] = {'Y', 'C', 'Y', '4', 'M', 'I', 'X', '1'};
+
+std::string pix_from_colorspace(const std::string &c) {
+  // 仅 8-bit；p10/p12 等高位深交给 ffmpeg 处理
+  if (c.empty() || c == "420" || c == "420jpeg" || c == "420paldv" ||
+      c == "420mpeg2")
+    return "yuv420p";
+  if (c == "422")
+    return "yuv422p";
+  if (c == "444")
+    return "yuv444p";
+  if (c == "mono")
+    return "gray";
+  return std::string();
+}
+
+std::string index_key(const fs::path &p) {
+  std::error_code ec;
+  std::ostringstream ss;
+  ss << "size=" << fs::file_size(p, ec)
+     << " mtime=" << fs::last_write_time(p, ec).time_since_epoch().count();
+  return ss.str();
+}
+
+bool load_index(const fs::path &p, const std::string &key,
+                std::vector<uint64_t> &offs) {
+  std::ifstream i(p, std::ios::binary);
+  char magic[sizeof(kIdxMagic)];
+  uint32_t klen = 0;
+  if (!i || !i.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, kIdxMagic, sizeof(magic)) != 0 ||
+      !i.read(reinterpret_cast<char *>(&klen), sizeof(klen)) || klen > 4096)
+    return false;
+  std::string k(klen, '\0');
+  uint64_t n = 0;
+  if (!i.read(&k[0], klen) || k != key ||
+      !i.read(reinterpret_cast<char *>(&n), sizeof(n)))
+    return false;
+  offs.resize((size_t)n);
+  return (bool)i.read(reinterpret_cast<char *>(offs.data()),
+                      (std::streamsize)(n * sizeof(uint64_t)));
+}
+
+void save_index(const fs::path &p, const std::string &key,
+                const std::vector<uint64_t> &offs) {
+  std::ofstream o(p, std::ios::binary | std::ios::trunc);
+  if (!o)
+    return;
+  const uint32_t klen = (uint32_t)key.size();
+  const uint64_t n = offs.size();
+  o.write(kIdxMagic, sizeof(kIdxMagic));
+  o.write(reinterpret_cast<const char *>(&klen), sizeof(klen));
+  o.write(key.data(), klen);
+  o.write(reinterpret_cast<const char *>(&n), sizeof(n));
+  o.write(reinterpret_cast<const char *>(offs.data()),
+          (std::streamsize)(n * sizeof(uint64_t)));
+}
+} // namespace
+
+bool y4m_parse_header(const uint8_t *data, size_t size, Y4mInfo &info) {
+  const size_t sig = sizeof(kSig) - 1;
+  if (size < sig || std::memcmp(data, kSig, sig) != 0)
+    return false;
+  const uint8_t *nl = static_cast<const uint8_t *>(
+      std::memchr(data, '\n', std::min<size_t>(size, 4096)));
+  if (!nl)
+    return false;
+  info = Y4mInfo{};
+  info.header_bytes = (size_t)(nl - data) + 1;
+  std::istringstream ss(std::string(reinterpret_cast<const char *>(data) + sig,
+                                    nl - data - sig));
+  std::string tok;
+  while (ss >> tok) {
+    const std::string v = tok.substr(1);
+    try {
+      switch (tok[0]) {
+      case 'W':
+        info.w = std::stoi(v);
+        break;
+      case 'H':
+        info.h = std::stoi(v);
+        break;
+      case 'F': {
+        auto c = v.find(':');
+        if (c != std::string::npos) {
+          info.fps_num = std::stoi(v.substr(0, c));
+          info.fps_den = std::stoi(v.substr(c + 1));
+        }
+        break;
+      }
+      case 'I':
+        info.interlace = v.empty() ? '?' : v[0];
+        break;
+      case 'C':
+        info.colorspace = v;
+        break;
+      default: // A（像素宽高比）、X（扩展）等忽略
+        break;
+      }
+    } catch (...) {
+      return false;
+    }
+  }
+  info.pix = pix_from_colorspace(info.colorspace);
+  return info.w > 0 && info.h > 0;
+}
+
+bool y4m_probe(const fs::path &p, Y4mInfo &info) {
+  MappedFile mf;
+  if (!mf.open(p) || !y4m_parse_header(mf.data(), mf.size(), info))
+    return false;
+  FrameGeometry g;
+  if (!frame_geometry(info.w, info.h, info.pix, g))
+    return true; // 头信息可用，但无法按字节定位帧
+
+  const fs::path cache = fs::path(p).concat(".y4midx");
+  const std::string key = index_key(p);
+  auto offs = std::make_shared<std::vector<uint64_t>>();
+  if (!load_index(cache, key, *offs)) {
+    offs->clear();
+    // 逐帧跳读：只访问每帧的 FRAME 行，不触及像素数据
+    size_t pos = info.header_bytes;
+    const size_t size = mf.size();
+    while (pos + 5 < size && std::memcmp(mf.data() + pos, "FRAME", 5) == 0) {
+      const size_t lim = std::min<size_t>(size - pos, 4096);
+      const void *nl = std::memchr(mf.data() + pos, '\n', lim);
+      if (!nl)
+        break;
+      const size_t data = (size_t)(static_cast<const uint8_t *>(nl) -
+                                   mf.data()) + 1;
+      if (data + g.frame_bytes > size)
+        break; // 截断的末帧
+      offs->push_back(data);
+      pos = data + g.frame_bytes;
+    }
+    save_index(cache, key, *offs);
+  }
+  info.offsets = std::move(offs);
+  return true;
+}
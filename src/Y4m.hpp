@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// YUV4MPEG2 头信息与帧偏移索引
+struct Y4mInfo {
+    int w=0, h=0;
+    int fps_num=0, fps_den=0;
+    char interlace='?';         // p/t/b/m，? 表示未声明
+    std::string colorspace;     // C 标记原文，如 420jpeg；未声明为空
+    std::string pix;            // 对应的 ffmpeg pix_fmt；不支持的格式为空
+    size_t header_bytes=0;      // 流头长度（含换行）
+    std::shared_ptr<const std::vector<uint64_t>> offsets; // 各帧像素数据的文件偏移
+};
+
+// 解析流头（"YUV4MPEG2 W.. H.. F.. I.. C..\n"）；不含帧索引
+bool y4m_parse_header(const uint8_t* data, size_t size, Y4mInfo& info);
+
+// 解析头并扫描 FRAME 标记建立索引（pix 不支持时 offsets 为空）。
+// 索引缓存于 <input>.y4midx（按文件大小与修改时间校验），写失败时忽略
+bool y4m_probe(const std::filesystem::path& p, Y4mInfo& info);
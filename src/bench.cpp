@@ -0,0 +1,381 @@
+#include "Defects.hpp"
+#include "Kernels.hpp"
+#include "Synth.hpp"
+#include "Telemetry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static void usage() {
+  std::cout
+      << "Usage:\n"
+         "  yuv-corruptor-bench [--sizes WxH,...] [--frames N] "
+         "[--content list]\n"
+         "                      [-t types] [--no-full] [-j jobs] [--threads "
+         "N]\n"
+         "                      [--fanout] [--native] [--work dir] [-o "
+         "report.json]\n"
+         "                      [--ffmpeg ffmpeg] [--ffprobe ffprobe]\n"
+         "  yuv-corruptor-bench --compare base.json new.json [--tolerance "
+         "0.10]\n"
+         "\n"
+         "Flags:\n"
+         "  --sizes WxH,...       Clip sizes (default 352x288,1280x720)\n"
+         "  --frames N            Frames per clip (default 60)\n"
+         "  --content list        CSV of gradient,noise,edges (default all)\n"
+         "  -t types              Defects to time one by one (default all)\n"
+         "  --no-full             Skip the run with the whole -t set at once\n"
+         "  -j / --threads / --fanout / --native\n"
+         "                        Passed through as in yuv-corruptor\n"
+         "  --work dir            Synthetic clips and outputs (default "
+         "bench_work)\n"
+         "  -o report.json        Report path (default bench_report.json)\n"
+         "  --compare a b         Compare two reports; exit 1 if any defect's "
+         "fps\n"
+         "                        dropped by more than --tolerance "
+         "(default 0.10)\n";
+}
+
+namespace {
+
+struct Result {
+  std::string clip, defect;
+  bool ok = false;
+  double wall_s = 0, cpu_s = 0, fps = 0;
+  long peak_rss_kb = 0;
+  uint64_t out_bytes = 0;
+  size_t frames = 0, outputs = 0;
+};
+
+double self_cpu_s() {
+#ifndef _WIN32
+  struct rusage ru {};
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6 +
+         ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+#else
+  return 0;
+#endif
+}
+
+// 本进程在一次测量内的峰值 RSS（原生处理阶段的缓冲在此，不在 ffmpeg 子进程里）。
+// ru_maxrss 是整个进程生命周期的峰值，不能按缺陷区分；Linux 上测量前向
+// /proc/self/clear_refs 写 5 把 VmHWM 重置为当前 RSS，测量后读 VmHWM。
+// 重置失败（或非 Linux）时不计本进程
+bool reset_self_peak_rss() {
+#ifdef __linux__
+  std::ofstream ofs("/proc/self/clear_refs");
+  ofs << "5";
+  ofs.flush();
+  return (bool)ofs;
+#else
+  return false;
+#endif
+}
+
+long self_peak_rss_kb() {
+  std::ifstream ifs("/proc/self/status");
+  std::string line;
+  while (std::getline(ifs, line))
+    if (line.compare(0, 6, "VmHWM:") == 0)
+      return std::atol(line.c_str() + 6);
+  return 0;
+}
+
+std::vector<std::string> split_csv(const std::string &v) {
+  std::vector<std::string> r;
+  size_t p = 0;
+  while (true) {
+    auto q = v.find(',', p);
+    r.push_back(v.substr(p, q == std::string::npos ? q : q - p));
+    if (q == std::string::npos)
+      break;
+    p = q + 1;
+  }
+  return r;
+}
+
+// 每条结果单独一行，compare 模式按行解析
+std::string json_line(const Result &r) {
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3);
+  ss << "{\"clip\":" << json_quote(r.clip)
+     << ",\"defect\":" << json_quote(r.defect)
+     << ",\"ok\":" << (r.ok ? "true" : "false") << ",\"frames\":" << r.frames
+     << ",\"outputs\":" << r.outputs << ",\"wall_s\":" << r.wall_s
+     << ",\"cpu_s\":" << r.cpu_s << ",\"fps\":" << r.fps
+     << ",\"peak_rss_kb\":" << r.peak_rss_kb << ",\"out_bytes\":" << r.out_bytes
+     << "}";
+  return ss.str();
+}
+
+Result measure(const Settings &base, const std::string &clip,
+               const std::string &label, const std::vector<DefectEntry> &sel) {
+  Result r;
+  r.clip = clip;
+  r.defect = label;
+  Context ctx;
+  ctx.cfg = base;
+  ctx.cfg.out_dir = base.out_dir / label;
+  if (!init_context(ctx))
+    return r;
+  proc_usage_total(true);
+  const bool self_rss = reset_self_peak_rss();
+  const double cpu0 = self_cpu_s();
+  const auto t0 = std::chrono::steady_clock::now();
+  std::vector<OutFile> outs;
+  r.ok = run_defects(ctx, sel, outs);
+  r.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+                 .count();
+  const ProcUsage u = proc_usage_total(true);
+  r.cpu_s = u.cpu_s + (self_cpu_s() - cpu0);
+  r.peak_rss_kb = std::max(u.max_rss_kb, self_rss ? self_peak_rss_kb() : 0L);
+  r.frames = ctx.total_frames;
+  r.outputs = outs.size();
+  for (auto &o : outs)
+    r.out_bytes += file_size_or(ctx.cfg.out_dir / o.filename);
+  // 聚合吞吐：所有输出的帧数之和 / 墙钟时间
+  if (r.wall_s > 0)
+    r.fps = (double)(r.frames * r.outputs) / r.wall_s;
+  return r;
+}
+
+// 读取本程序写出的报告（每行一条结果）
+bool load_report(const fs::path &p, std::map<std::string, Result> &out) {
+  std::ifstream ifs(p);
+  if (!ifs)
+    return false;
+  static const std::regex re_s(R"re("(clip|defect)":"([^"]*)")re");
+  static const std::regex re_n(R"re("(fps|wall_s|cpu_s|peak_rss_kb|out_bytes)":([0-9.eE+-]+))re");
+  std::string line;
+  while (std::getline(ifs, line)) {
+    if (line.find("\"defect\"") == std::string::npos)
+      continue;
+    Result r;
+    for (std::sregex_iterator it(line.begin(), line.end(), re_s), end;
+         it != end; ++it)
+      ((*it)[1] == "clip" ? r.clip : r.defect) = (*it)[2];
+    for (std::sregex_iterator it(line.begin(), line.end(), re_n), end;
+         it != end; ++it) {
+      const std::string k = (*it)[1];
+      const double v = std::stod((*it)[2]);
+      if (k == "fps")
+        r.fps = v;
+      else if (k == "wall_s")
+        r.wall_s = v;
+      else if (k == "cpu_s")
+        r.cpu_s = v;
+      else if (k == "peak_rss_kb")
+        r.peak_rss_kb = (long)v;
+      else
+        r.out_bytes = (uint64_t)v;
+    }
+    r.ok = line.find("\"ok\":true") != std::string::npos;
+    out[r.clip + "/" + r.defect] = r;
+  }
+  return true;
+}
+
+int compare(const fs::path &a, const fs::path &b, double tol) {
+  std::map<std::string, Result> ra, rb;
+  if (!load_report(a, ra) || !load_report(b, rb)) {
+    std::cerr << "cannot read reports\n";
+    return 2;
+  }
+  size_t regressions = 0;
+  std::cout << std::fixed << std::setprecision(2);
+  for (auto &kv : ra) {
+    auto it = rb.find(kv.first);
+    if (it == rb.end()) {
+      std::cout << "[missing] " << kv.first << "\n";
+      ++regressions;
+      continue;
+    }
+    const Result &x = kv.second, &y = it->second;
+    const double d = x.fps > 0 ? y.fps / x.fps - 1.0 : 0.0;
+    const char *tag = "ok";
+    if (x.ok && !y.ok) {
+      tag = "FAILED";
+      ++regressions;
+    } else if (d < -tol) {
+      tag = "REGRESSION";
+      ++regressions;
+    } else if (d > tol) {
+      tag = "faster";
+    }
+    std::cout << "[" << tag << "] " << kv.first << " fps " << x.fps << " -> "
+              << y.fps << " (" << std::showpos << d * 100 << std::noshowpos
+              << "%) cpu " << x.cpu_s << " -> " << y.cpu_s << "s rss "
+              << x.peak_rss_kb << " -> " << y.peak_rss_kb << "KB\n";
+  }
+  for (auto &kv : rb)
+    if (!ra.count(kv.first))
+      std::cout << "[new] " << kv.first << "\n";
+  std::cout << regressions << " regression(s) at tolerance " << tol * 100
+            << "%\n";
+  return regressions ? 1 : 0;
+}
+
+bool parse_WxH(const std::string &s, int &w, int &h) {
+  std::regex re(R"(^\s*(\d+)\s*x\s*(\d+)\s*$)", std::regex::icase);
+  std::smatch m;
+  if (!std::regex_match(s, m, re))
+    return false;
+  w = std::stoi(m[1].str());
+  h = std::stoi(m[2].str());
+  return w > 0 && h > 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Settings s;
+  s.fingerprint = false; // 后台哈希会计入被测时间
+  s.seed = 1; // 固定种子：各次运行的参数一致
+  std::vector<std::string> sizes{"352x288", "1280x720"};
+  std::vector<std::string> contents{"gradient", "noise", "edges"};
+  size_t frames = 60;
+  bool full = true;
+  fs::path work = "bench_work", report = "bench_report.json";
+  bool ok = true;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    auto need = [&](int n = 1) {
+      if (i + n >= argc) {
+        ok = false;
+        return false;
+      }
+      return true;
+    };
+    if (a == "--compare" && need(2)) {
+      fs::path x = argv[i + 1], y = argv[i + 2];
+      double tol = 0.10;
+      if (i + 4 < argc && std::string(argv[i + 3]) == "--tolerance")
+        tol = std::stod(argv[i + 4]);
+      return compare(x, y, tol);
+    } else if (a == "--sizes" && need()) {
+      sizes = split_csv(argv[++i]);
+    } else if (a == "--frames" && need()) {
+      frames = (size_t)std::stoull(argv[++i]);
+    } else if (a == "--content" && need()) {
+      contents = split_csv(argv[++i]);
+    } else if (a == "-t" && need()) {
+      s.types = split_csv(argv[++i]);
+    } else if (a == "--no-full") {
+      full = false;
+    } else if (a == "-j" && need()) {
+      s.jobs = std::stoi(argv[++i]);
+    } else if (a == "--threads" && need()) {
+      s.threads = std::stoi(argv[++i]);
+    } else if (a == "--fanout") {
+      s.fanout = true;
+    } else if (a == "--native") {
+      s.native = true;
+    } else if (a == "--work" && need()) {
+      work = argv[++i];
+    } else if (a == "-o" && need()) {
+      report = argv[++i];
+    } else if (a == "--ffmpeg" && need()) {
+      s.ffmpeg = argv[++i];
+    } else if (a == "--ffprobe" && need()) {
+      s.ffprobe = argv[++i];
+    } else {
+      std::cerr << "Unknown or incomplete arg: " << a << "\n";
+      ok = false;
+    }
+  }
+  if (!ok || frames == 0) {
+    usage();
+    return 1;
+  }
+
+  std::vector<DefectEntry> sel;
+  for (auto &e : defect_table()) {
+    bool want = s.types.empty() || s.types[0] == "all";
+    for (auto &t : s.types)
+      want |= t == e.type;
+    if (want)
+      sel.push_back(e);
+  }
+  if (!ensure_dir(work)) {
+    std::cerr << "cannot create work dir\n";
+    return 2;
+  }
+
+  std::vector<Result> results;
+  for (auto &sz : sizes) {
+    int w = 0, h = 0;
+    if (!parse_WxH(sz, w, h)) {
+      std::cerr << "Invalid size " << sz << "\n";
+      return 1;
+    }
+    w += w & 1;
+    h += h & 1;
+    for (auto &cn : contents) {
+      SynthContent c;
+      if (!synth_parse(cn, c)) {
+        std::cerr << "Unknown content " << cn << "\n";
+        return 1;
+      }
+      const std::string clip = std::string(synth_name(c)) + "_" +
+                               std::to_string(w) + "x" + std::to_string(h);
+      const fs::path in =
+          work / (clip + "_" + std::to_string(frames) + "f.yuv");
+      if (!synth_write(in, c, w, h, frames, s.seed)) {
+        std::cerr << "cannot write " << in << "\n";
+        return 2;
+      }
+      Settings cs = s;
+      cs.in_path = in.string();
+      cs.w = w;
+      cs.h = h;
+      cs.out_dir = work / "out" / clip;
+      for (auto &e : sel) {
+        results.push_back(measure(cs, clip, e.type, {e}));
+        std::cerr << "[bench] " << clip << " " << e.type << " "
+                  << std::fixed << std::setprecision(1) << results.back().fps
+                  << " fps\n";
+      }
+      if (full && sel.size() > 1) {
+        results.push_back(measure(cs, clip, "all", sel));
+        std::cerr << "[bench] " << clip << " all " << std::fixed
+                  << std::setprecision(1) << results.back().fps << " fps\n";
+      }
+    }
+  }
+
+  std::string ver = exec_read_all({s.ffmpeg, "-version"});
+  ver = ver.substr(0, ver.find('\n'));
+  std::ostringstream js;
+  js << "{\n\"version\":1,\n\"ffmpeg\":" << json_quote(ver)
+     << ",\n\"kernels\":" << json_quote(kernels_isa())
+     << ",\n\"cpus\":" << available_cpus() << ",\n\"frames\":" << frames
+     << ",\n\"results\":[\n";
+  for (size_t i = 0; i < results.size(); ++i)
+    js << json_line(results[i]) << (i + 1 < results.size() ? ",\n" : "\n");
+  js << "]\n}\n";
+  if (!write_text(report, js.str())) {
+    std::cerr << "cannot write report\n";
+    return 2;
+  }
+  std::cout << "Report: " << report << "\n";
+  for (auto &r : results)
+    if (!r.ok)
+      return 3;
+  return 0;
+}
@@ -1,4 +1,6 @@
+#include "Batch.hpp"
 #include "Defects.hpp"
+#include <csignal>
 #include <filesystem>
 #include <iostream>
 #include <regex>
@@ -7,11 +9,24 @@ static void usage() {
   std::cout
       << "Usage:\n"
          "  yuv-corruptor <input.yuv> -r WxH [-f fps] [-p pixfmt] [-s seed]\n"
-         "                  [-t types] [-o outdir] [--ffmpeg ffmpeg] "
-         "[--ffprobe ffprobe]\n"
+         "                  [-t types] [-o outdir] [-j jobs] [--threads N]\n"
+         "                  [--affinity] [--fanout] [--native]\n"
+         "                  [--timeout sec] [--stats-step N]\n"
+         "                  [--cache dir] [--cache-size N[K|M|G]]\n"
+         "                  [--no-fingerprint] [--hash-sidecar] [--spans]\n"
+         "                  [--start N] [--frames N] [--combine]\n"
+         "                  [--ffmpeg ffmpeg] [--ffprobe ffprobe]\n"
          "\n"
          "Positional:\n"
          "  <input.yuv>           Path to raw YUV file (8-bit by default)\n"
+         "                        Batch: a directory (.yuv/.y4m, recursive), "
+         "a glob\n"
+         "                        like 'clips/*_1080p_*.yuv', or a list file "
+         "(@list or\n"
+         "                        .txt/.lst, one path per line); WxH/fps are "
+         "inferred\n"
+         "                        per clip, outputs go to <outdir>/<clip>/ plus "
+         "index.txt\n"
          "\n"
          "Flags:\n"
          "  -r WxH                Resolution, e.g. -r 176x144 (if omitted, try "
@@ -23,6 +38,62 @@ static void usage() {
          "{blocky,brightness,jitter,smooth,highclip,chroma,luma,grain,ringing,"
          "banding,ghosting,colorspace,repeat,all}\n"
          "  -o outdir             Output directory (default out_<timestamp>)\n"
+         "  -j jobs               Defects generated in parallel (default 1, 0=auto "
+         "from\n"
+         "                        core budget and per-job cost); in batch "
+         "mode one\n"
+         "                        queue is shared by all clips\n"
+         "  --threads N           Core budget shared by all ffmpeg jobs; each "
+         "job gets\n"
+         "                        explicit -threads/-filter_threads (default: "
+         "all CPUs)\n"
+         "  --affinity            Pin each job to its own CPUs (Linux)\n"
+         "  --fanout              Decode input once and write all outputs from "
+         "one\n"
+         "                        ffmpeg (with -j N: N such processes)\n"
+         "  --native              Process supported defects in-process and "
+         "pipe raw\n"
+         "                        frames to the encoder "
+         "(brightness,highclip,banding,jitter,\n"
+         "                        smooth,ringing,grain,ghosting,luma,\n"
+         "                        chroma,colorspace,repeat)\n"
+         "  --timeout <sec>       Kill an ffmpeg job after this many seconds "
+         "(POSIX)\n"
+         "  --stats-step <N>      Analyse every Nth frame for content-adaptive "
+         "params\n"
+         "                        (default 0 = auto, ~240 frames)\n"
+         "  --cache <dir>         Reuse outputs from a content-addressed "
+         "result cache\n"
+         "                        (key: input hash + defect + filter/encoder "
+         "args +\n"
+         "                        ffmpeg version); hits are hard-linked into "
+         "outdir\n"
+         "  --cache-size <N>      Cache size limit, LRU-trimmed after each run "
+         "(default\n"
+         "                        20G, 0 = unlimited)\n"
+         "  --no-fingerprint      Skip hashing the input (whole file + per "
+         "frame) for\n"
+         "                        the manifest; hashing runs in the background "
+         "by default\n"
+         "  --hash-sidecar        Also write per-frame hashes to "
+         "input_hashes.bin\n"
+         "  --start <N>           First frame index (raw: skipped by byte "
+         "offset,\n"
+         "                        y4m: seeked by timestamp); defect spans and "
+         "manifest\n"
+         "                        frame numbers are relative\n"
+         "  --frames <N>          Number of frames from --start (default: to "
+         "the end)\n"
+         "  --spans               Re-encode only the frame spans touched by "
+         "chroma/luma/\n"
+         "                        repeat and splice them into one shared clean "
+         "encode\n"
+         "                        (keyframes forced at span edges, stream "
+         "copy)\n"
+         "  --combine             Apply all selected defects to one output in "
+         "a single\n"
+         "                        decode/encode (manifest lists each "
+         "component)\n"
          "  --ffmpeg <path>       ffmpeg executable (default: ffmpeg in PATH)\n"
          "  --ffprobe <path>      ffprobe executable (default: ffprobe in "
          "PATH)\n"
@@ -31,36 +102,9 @@ static void usage() {
          "--in/--w/--h/--fps/--pix/--seed/--types/--out\n";
 }
 
-static bool infer_from_filename(const std::string &in_path, int &w, int &h,
-                                int &fps) {
-  try {
-    std::filesystem::path p(in_path);
-    std::string name = p.stem().string();
-    // Match ..._<W>x<H>[_<FPS>]_...
-    std::regex re(
-        R"((?:^|[^0-9])([0-9]+)\s*x\s*([0-9]+)(?:[^0-9]+([0-9]{1,3}))?)",
-        std::regex::icase);
-    std::smatch m;
-    if (std::regex_search(name, m, re)) {
-      int iw = std::stoi(m[1].str());
-      int ih = std::stoi(m[2].str());
-      int ifps = fps; // keep incoming default unless group 3 exists
-      if (m.size() >= 4 && m[3].matched) {
-        try {
-          ifps = std::stoi(m[3].str());
-        } catch (...) {
-        }
-      }
-      if (iw > 0 && ih > 0) {
-        w = iw;
-        h = ih;
-        fps = ifps;
-        return true;
-      }
-    }
-  } catch (...) {
-  }
-  return false;
+static void on_interrupt(int) {
+  // Ctrl-C：结束所有运行中的 ffmpeg，已启动的任务标记为 FAILED
+  cancel_all_procs();
 }
 
 static bool parse_WxH(const std::string &s, int &w, int &h) {
@@ -77,6 +121,26 @@ static bool parse_WxH(const std::string &s, int &w, int &h) {
   }
 }
 
+// 字节数，可带 K/M/G 后缀（1024 进制）
+static bool parse_size(const std::string &s, uint64_t &out) {
+  std::regex re(R"(^\s*(\d+)\s*([kKmMgG]?)[bB]?\s*$)");
+  std::smatch m;
+  if (!std::regex_match(s, m, re))
+    return false;
+  try {
+    out = std::stoull(m[1].str());
+  } catch (...) {
+    return false;
+  }
+  const std::string u = m[2].str();
+  const int shift = u.empty() ? 0
+                    : (u[0] == 'k' || u[0] == 'K') ? 10
+                    : (u[0] == 'm' || u[0] == 'M') ? 20
+                                                   : 30;
+  out <<= shift;
+  return true;
+}
+
 int main(int argc, char **argv) {
   Settings s;
   bool ok = true;
@@ -129,6 +193,48 @@ int main(int argc, char **argv) {
       }
     } else if (a == "-o" && need()) {
       s.out_dir = argv[++i];
+    } else if ((a == "-j" || a == "--jobs") && need()) {
+      s.jobs = std::stoi(argv[++i]);
+      if (s.jobs < 0) {
+        std::cerr << "Invalid -j " << s.jobs << "\n";
+        ok = false;
+      }
+    } else if (a == "--threads" && need()) {
+      s.threads = std::stoi(argv[++i]);
+      if (s.threads < 0) {
+        std::cerr << "Invalid --threads " << s.threads << "\n";
+        ok = false;
+      }
+    } else if (a == "--affinity") {
+      s.affinity = true;
+    } else if (a == "--fanout") {
+      s.fanout = true;
+    } else if (a == "--native") {
+      s.native = true;
+    } else if (a == "--timeout" && need()) {
+      s.timeout = std::stod(argv[++i]);
+    } else if (a == "--stats-step" && need()) {
+      s.stats_step = (size_t)std::stoull(argv[++i]);
+    } else if (a == "--cache" && need()) {
+      s.cache_dir = argv[++i];
+    } else if (a == "--cache-size" && need()) {
+      std::string v = argv[++i];
+      if (!parse_size(v, s.cache_max)) {
+        std::cerr << "Invalid --cache-size " << v << "\n";
+        ok = false;
+      }
+    } else if (a == "--no-fingerprint") {
+      s.fingerprint = false;
+    } else if (a == "--hash-sidecar") {
+      s.hash_sidecar = true;
+    } else if (a == "--start" && need()) {
+      s.start = (size_t)std::stoull(argv[++i]);
+    } else if (a == "--frames" && need()) {
+      s.frames = (size_t)std::stoull(argv[++i]);
+    } else if (a == "--spans") {
+      s.spans = true;
+    } else if (a == "--combine") {
+      s.combine = true;
     } else if (a == "--ffmpeg" && need()) {
       s.ffmpeg = argv[++i];
     } else if (a == "--ffprobe" && need()) {
@@ -170,6 +276,26 @@ int main(int argc, char **argv) {
     }
   }
 
+  auto has = [&](const std::string &t) {
+    if (s.types.empty() ||
+        (s.types.size() == 1 && (s.types[0].empty() || s.types[0] == "all")))
+      return true;
+    for (auto &x : s.types)
+      if (x == t)
+        return true;
+    return false;
+  };
+  std::vector<DefectEntry> sel;
+  for (auto &e : defect_table())
+    if (has(e.type))
+      sel.push_back(e);
+
+  // 批处理：目录/通配符/列表文件，WxH 与 fps 按文件名逐个推断
+  if (ok && !s.in_path.empty() && is_batch_spec(s.in_path)) {
+    std::signal(SIGINT, on_interrupt);
+    return run_batch(s, sel, s.w > 0 && s.h > 0, fps_set_by_cli);
+  }
+
   // Try infer WxH / fps from filename if missing
   if (ok && !s.in_path.empty() && (s.w <= 0 || s.h <= 0 || !fps_set_by_cli)) {
     int iw = s.w, ih = s.h, ifps = s.fps;
@@ -197,48 +323,13 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  std::signal(SIGINT, on_interrupt);
   Context ctx{s};
   if (!init_context(ctx))
     return 2;
 
   std::vector<OutFile> outs;
-  auto has = [&](const std::string &t) {
-    if (s.types.empty() ||
-        (s.types.size() == 1 && (s.types[0].empty() || s.types[0] == "all")))
-      return true;
-    for (auto &x : s.types)
-      if (x == t)
-        return true;
-    return false;
-  };
-
-  bool all_ok = true;
-  if (has("blocky"))
-    all_ok &= make_blocky(ctx, outs);
-  if (has("brightness"))
-    all_ok &= make_brightness(ctx, outs);
-  if (has("jitter"))
-    all_ok &= make_jitter(ctx, outs);
-  if (has("smooth"))
-    all_ok &= make_smooth(ctx, outs);
-  if (has("highclip"))
-    all_ok &= make_highclip(ctx, outs);
-  if (has("chroma"))
-    all_ok &= make_chroma_bleed(ctx, outs);
-  if (has("luma"))
-    all_ok &= make_luma_bleed(ctx, outs);
-  if (has("grain"))
-    all_ok &= make_grain(ctx, outs);
-  if (has("ringing"))
-    all_ok &= make_ringing(ctx, outs);
-  if (has("banding"))
-    all_ok &= make_banding(ctx, outs);
-  if (has("ghosting"))
-    all_ok &= make_ghosting(ctx, outs);
-  if (has("colorspace"))
-    all_ok &= make_colorspace_mismatch(ctx, outs);
-  if (has("repeat"))
-    all_ok &= make_repeat(ctx, outs);
+  bool all_ok = run_defects(ctx, sel, outs);
 
   if (!write_manifest(ctx, outs)) {
     std::cerr << "failed to write manifest\n";